@@ -2,8 +2,10 @@
  *
  * Prints all unicode characters (utf-8 encoded)
  * that fit in 1 byte.
+ * Use `atable [START [FINISH]]` (in hex) for another range of codepoints,
+ * up to 10FFFF.
  *
- * Copyright (C) 2023 Daniel K Hashimoto
+ * Copyright (C) 2023, 2026 Daniel K Hashimoto
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -19,8 +21,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
 
 typedef unsigned char byte;
 
@@ -98,71 +105,292 @@ void toutf8(const byte c, char buf[static UTF8BUFLEN]) {
     }
 }
 
-void print(const byte c, const char str[static 1]) {
-    static const char fmtstr[] =
-        " (%03hhu) %02hhX - %."UTF8BUFLENSTR"s %s";
-    char utf8[UTF8BUFLEN] = {0};
-    toutf8(c, utf8);
-    printf(fmtstr, c, c, utf8, str);
-}
+/* Note: the table is rendered into one big buffer,
+ * from pieces precomputed at startup (`make_tables`):
+ * the glyphs of the first 256 codepoints, digit pairs and the dash line.
+ * A cell is " (DEC) HEX - GLYPH " followed by a separator,
+ * where DEC and HEX have as many digits as FINISH needs (at least 3 and 2)
+ * and GLYPH is 4 columns wide.
+ */
+#define CODEPOINT_MAX 0x10FFFF
+#define GLYPH_MAX_LEN 8
+#define DEC_MAX_LEN 7
+#define HEX_MAX_LEN 6
+#define CELL_MAX_LEN (12 + DEC_MAX_LEN + HEX_MAX_LEN + GLYPH_MAX_LEN)
+#define DASHLINE_MAX_LEN (4 * CELL_MAX_LEN + 3)
+#define OUT_BUF_LEN 0x100000
 
 const char sep[] = "+";
 const char mid[] = "|";
 const char end[] = "|\n|";
 
-void printdashline(const bool cont) {
-    static const char dashes[] = "-----------------";
-    for ( byte i = 0; i < 3; i += 1 ) {
-        printf(dashes);
-        printf(sep);
+static struct {
+    char text[GLYPH_MAX_LEN];
+    byte len;
+} glyphs[0x100];
+
+static char dec_pairs[100][2];
+static char hex_pairs[0x100][2];
+
+static struct {
+    byte dec_len;
+    byte hex_len;
+    char dashline[DASHLINE_MAX_LEN];
+    size_t dashline_len;
+} layout;
+
+static struct {
+    char buf[OUT_BUF_LEN];
+    size_t len;
+} out;
+
+void out_flush(void) {
+    size_t done = 0;
+    while ( done < out.len ) {
+        const size_t n = fwrite(out.buf + done, sizeof(out.buf[0]), out.len - done, stdout);
+        if ( n == 0 ) {
+            break;
+        }
+        done += n;
+    }
+    out.len = 0;
+}
+
+static inline
+void out_reserve(const size_t len) {
+    if ( OUT_BUF_LEN - out.len < len ) {
+        out_flush();
+    }
+}
+
+static inline
+void out_write(const char str[], const size_t len) {
+    memcpy(out.buf + out.len, str, len);
+    out.len += len;
+}
+
+void make_tables(const uint32_t finish) {
+    static const char hex[] = "0123456789ABCDEF";
+    static const char dashes[] = "-------------------------";
+
+    for ( unsigned int c = 0; c < 0x100; c += 1 ) {
+        char utf8[UTF8BUFLEN] = {0};
+        byte len = 0;
+        toutf8((byte) c, utf8);
+        // Note: as "%.5s " would print it
+        while ( len < UTF8BUFLEN && utf8[len] != '\0' ) {
+            glyphs[c].text[len] = utf8[len];
+            len += 1;
+        }
+        glyphs[c].text[len] = ' ';
+        glyphs[c].len = len + 1;
+        hex_pairs[c][0] = hex[c >> 4];
+        hex_pairs[c][1] = hex[c & 0xF];
+    }
+    for ( byte d = 0; d < 100; d += 1 ) {
+        dec_pairs[d][0] = (char) ('0' + d / 10);
+        dec_pairs[d][1] = (char) ('0' + d % 10);
+    }
+
+    layout.dec_len = 3;
+    for ( uint32_t x = 1000; x <= finish; x *= 10 ) {
+        layout.dec_len += 1;
+    }
+    layout.hex_len = 2;
+    for ( uint32_t x = 0x100; x <= finish; x <<= 4 ) {
+        layout.hex_len += 1;
+    }
+
+    {
+        const size_t width = 12u + layout.dec_len + layout.hex_len;
+        char *line = layout.dashline;
+        size_t len = 0;
+        for ( byte i = 0; i < 4; i += 1 ) {
+            if ( i > 0 ) {
+                line[len] = sep[0];
+                len += 1;
+            }
+            memcpy(line + len, dashes, width);
+            len += width;
+        }
+        layout.dashline_len = len;
+    }
+}
+
+// Note: glyph of codepoints above 0xFF, as "'c'  " (or "SURR " for surrogates)
+byte toutf8_wide(const uint32_t cp, char buf[static GLYPH_MAX_LEN]) {
+    byte len = 0;
+    if ( 0xD800 <= cp && cp < 0xE000 ) {
+        memcpy(buf, "SURR ", 5);
+        return 5;
+    }
+    buf[len++] = '\'';
+    if ( cp < 0x800 ) {
+        buf[len++] = (char) (0xC0 | (cp >> 6));
+    } else if ( cp < 0x10000 ) {
+        buf[len++] = (char) (0xE0 | (cp >> 12));
+        buf[len++] = (char) (0x80 | ((cp >> 6) & 0x3F));
+    } else {
+        buf[len++] = (char) (0xF0 | (cp >> 18));
+        buf[len++] = (char) (0x80 | ((cp >> 12) & 0x3F));
+        buf[len++] = (char) (0x80 | ((cp >> 6) & 0x3F));
+    }
+    buf[len++] = (char) (0x80 | (cp & 0x3F));
+    buf[len++] = '\'';
+    buf[len++] = ' ';
+    buf[len++] = ' ';
+    return len;
+}
+
+static inline
+void print(const uint32_t cp, const char str[], const size_t str_len) {
+    char *dst = out.buf + out.len;
+    size_t len = 0;
+
+    dst[len++] = ' ';
+    dst[len++] = '(';
+    {
+        uint32_t x = cp;
+        for ( byte i = layout.dec_len; i > 1; i -= 2 ) {
+            memcpy(dst + len + i - 2, dec_pairs[x % 100], 2);
+            x /= 100;
+        }
+        if ( layout.dec_len & 1 ) {
+            dst[len] = dec_pairs[x % 10][1];
+        }
+        len += layout.dec_len;
+    }
+    dst[len++] = ')';
+    dst[len++] = ' ';
+    {
+        uint32_t x = cp;
+        for ( byte i = layout.hex_len; i > 1; i -= 2 ) {
+            memcpy(dst + len + i - 2, hex_pairs[x & 0xFF], 2);
+            x >>= 8;
+        }
+        if ( layout.hex_len & 1 ) {
+            dst[len] = hex_pairs[x & 0xF][1];
+        }
+        len += layout.hex_len;
     }
-    printf(dashes);
+    dst[len++] = ' ';
+    dst[len++] = '-';
+    dst[len++] = ' ';
+    if ( cp < 0x100 ) {
+        memcpy(dst + len, glyphs[cp].text, glyphs[cp].len);
+        len += glyphs[cp].len;
+    } else {
+        len += toutf8_wide(cp, dst + len);
+    }
+    memcpy(dst + len, str, str_len);
+    len += str_len;
+
+    out.len += len;
+}
+
+void printdashline(const bool cont) {
+    out_reserve(DASHLINE_MAX_LEN + sizeof(end));
+    out_write(layout.dashline, layout.dashline_len);
     if (cont) {
-        printf(end);
+        out_write(end, sizeof(end) - 1);
+    }
+}
+
+// Note: terminal columns of utf-8 text (each character taking one)
+size_t columns(const char str[], const size_t len) {
+    size_t cols = 0;
+    for ( size_t i = 0; i < len; i += 1 ) {
+        cols += ((byte) str[i] & 0xC0) != 0x80;
     }
+    return cols;
 }
 
-void printline(const byte ci) {
+void printline(const uint32_t ci) {
     assert((ci & 0x03) == 0);
+    out_reserve(4 * (CELL_MAX_LEN + sizeof(end)));
+    const size_t row = out.len;
     for ( byte i = 0; i < 3; i += 1 ) {
-        const byte c = ci | i;
-        print(c, mid);
+        const uint32_t c = ci | i;
+        print(c, mid, sizeof(mid) - 1);
     }
-    print(ci | 0x03, end);
+    print(ci | 0x03, end, sizeof(end) - 1);
+    // Note: the row (up to its last "|") is as wide as the dash lines
+    assert(columns(out.buf + row, out.len - row - (sizeof(end) - 1)) == layout.dashline_len);
 }
 
-#define START 0x00
-#define FINISH 0xFF
-int main(void) {
-    byte start = START >> 2;
-    byte finish = (FINISH >> 2) + 1;
-
+// Note: rows starting at these get a dash line before them (then, one every 0x100)
+bool is_sep(const uint32_t ci) {
     static const byte sep_inds[] = {
         0x20, 0x30, 0x40, 0x60,
         0x80, 0xA0,
     };
     static const byte sep_len = sizeof(sep_inds);
-    byte sepi = 0;
-    while ( sep_inds[sepi] <= ((start + 1) << 2) ) {
-        sepi += 1;
-    };
+    if ( ci >= 0x100 ) {
+        return (ci & 0xFF) == 0;
+    }
+    for ( byte sepi = 0; sepi < sep_len; sepi += 1 ) {
+        if ( ci == sep_inds[sepi] ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Note: a hexadecimal codepoint, without sign or leading spaces
+ * (which `strtoul` would accept)
+ */
+bool parse_codepoint(const char *s, uint32_t *cp) {
+    char *rest;
+    unsigned long n;
+    if ( !isxdigit((unsigned char) s[0]) ) {
+        return false;
+    }
+    errno = 0;
+    n = strtoul(s, &rest, 16);
+    if ( *rest != '\0' || errno != 0 || n > CODEPOINT_MAX ) {
+        return false;
+    }
+    *cp = (uint32_t) n;
+    return true;
+}
+
+#define START 0x00
+#define FINISH 0xFF
+int main(const int argc, const char *argv[]) {
+    uint32_t first = START;
+    uint32_t last = FINISH;
+
+    if ( argc > 3 || (argc > 1 && !parse_codepoint(argv[1], &first))
+        || (argc > 2 && !parse_codepoint(argv[2], &last)) ) {
+        fprintf(stderr, "usage: %s [START [FINISH]] (hexadecimal, up to %X)\n", argv[0], CODEPOINT_MAX);
+        return 1;
+    }
+    if ( first > last ) {
+        fprintf(stderr, "Expected START <= FINISH\n");
+        return 1;
+    }
+
+    make_tables(last);
+
+    const uint32_t start = first >> 2;
+    const uint32_t finish = (last >> 2) + 1;
 
     { // Print table
-        printf("|");
+        out_write("|", 1);
         printdashline(true);
         printline(start << 2);
 
-        for ( byte b = start + 1; b < finish; b += 1 ) {
-            const byte ci = b << 2;
-            if ( sepi < sep_len && ci == sep_inds[sepi] ) {
+        for ( uint32_t b = start + 1; b < finish; b += 1 ) {
+            const uint32_t ci = b << 2;
+            if ( is_sep(ci) ) {
                 printdashline(true);
-                sepi += 1;
             }
-            assert( sepi == sep_len || ci < sep_inds[sepi] );
-
             printline(ci);
         }
         printdashline(false);
-        printf("|\n");
+        out_reserve(2);
+        out_write("|\n", 2);
+        out_flush();
     }
+    return 0;
 }
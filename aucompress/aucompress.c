@@ -3,6 +3,7 @@
  * Small and simple implementation of `compress`.
  * Works only with `stdin` and `stdout`.
  * Use flag `-d` to decompress.
+ * Use flag `--profile` to print where the time went on stderr (see `cutils_prof.h`).
  *
  * Copyright (C) 2025 Daniel K Hashimoto
  *
@@ -19,13 +20,25 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+/* Note: I/O goes through `cutils_io.h`, which is POSIX */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 #include <assert.h>
 
+#define HASHI_CUTILS_IO_IMPLEMENTATION
+#include "../cutils_io.h"
+
+#define HASHI_CUTILS_PROF_IMPLEMENTATION
+#include "../cutils_prof.h"
+
 #define ARRLEN(x) (sizeof(x)/sizeof((x)[0]))
 
 typedef unsigned char byte;
 typedef unsigned short halfword;
+typedef unsigned int word;
 
 typedef struct {
     halfword head;
@@ -46,6 +59,10 @@ struct GlobalState {
 static byte magic[3] = { 0x1F, 0x9D, 0x90 };
 static byte readbuf[0x100];
 
+PROF_REGION(prof_find, "table_find_or_add_symbol");
+PROF_REGION(prof_output, "output_symbol");
+PROF_REGION(prof_decompress, "decompress_symbol");
+
 // TODO: separate into an array of pointers
 // TODO: use exponential allocation
 SymbolDef symbol_table[0xFF * 0x100];
@@ -53,16 +70,26 @@ byte symbol_table_meta_size = 1;
 byte symbol_table_last_size = 1;
 
 static
-void inner_write(FILE *fout, const byte *buf, halfword len) {
-    while (0 < len) {
-        const halfword n = fwrite(buf, sizeof(*buf), len, fout);
-        len -= n;
-    }
+void inner_write(CioWriter *fout, const byte *buf, halfword len) {
+    cio_write(fout, buf, len);
 }
 
 static
-halfword inner_read(FILE *fin, byte *buf, halfword len) {
-    return fread(buf, sizeof(*buf), len, fin);
+halfword inner_read(CioReader *fin, byte *buf, halfword len) {
+    return (halfword) cio_read_into(fin, buf, len);
+}
+
+#define DEBUG_LINE_LEN 0x20
+
+static
+void inner_printf(CioWriter *fout, const char *fmt, ...) {
+    va_list args;
+    byte *dst = cio_reserve(fout, DEBUG_LINE_LEN);
+    int n;
+    va_start(args, fmt);
+    n = vsnprintf((char *) dst, DEBUG_LINE_LEN, fmt, args);
+    va_end(args);
+    fout->len += (size_t) n;
 }
 
 halfword table_len(void) {
@@ -136,21 +163,21 @@ halfword table_numbits(void) {
     return 9 + msb(symbol_table_meta_size);
 }
 
-void output_symbol_debug(FILE *fout, byte num_bits, halfword s) {
+void output_symbol_debug(CioWriter *fout, byte num_bits, halfword s) {
     if (s < 0x100) {
         if (0x19 < s && s < 0x7F) {
-            fprintf(fout, "%hhu<0x%02X|%c>\n", num_bits, s, s);
+            inner_printf(fout, "%hhu<0x%02X|%c>\n", num_bits, s, s);
         } else {
-            fprintf(fout, "%hhu<0x%02X>\n", num_bits, s);
+            inner_printf(fout, "%hhu<0x%02X>\n", num_bits, s);
         }
     } else if (s == 0x100) {
-        fprintf(fout, "%hhu[Escape]\n", num_bits);
+        inner_printf(fout, "%hhu[Escape]\n", num_bits);
     } else {
-        fprintf(fout, "%hhu[0x%04X]\n", num_bits, s);
+        inner_printf(fout, "%hhu[0x%04X]\n", num_bits, s);
     }
 }
 
-void output_symbol(FILE *fout, halfword s) {
+void output_symbol(CioWriter *fout, halfword s) {
     const halfword num_bits = table_numbits();
     switch ((OutputMode) globals.output_mode) {
         case OUTPUT_BITS: {
@@ -164,7 +191,7 @@ void output_symbol(FILE *fout, halfword s) {
                     size += bits_left;
                     bits_left = 0;
                 } else {
-                    inner_write(fout, &buf, 1);
+                    cio_put(fout, buf);
                     bits_left = bits_left - (8 - size);
                     buf = 0;
                     size = 0;
@@ -179,23 +206,23 @@ void output_symbol(FILE *fout, halfword s) {
     }
 }
 
-void output_curr_symbol(FILE *fout) {
+void output_curr_symbol(CioWriter *fout) {
     const halfword curr_symbol = table_curr_symbol();
     output_symbol(fout, curr_symbol);
 }
 
-void output_header(FILE *fout) {
+void output_header(CioWriter *fout) {
     switch ((OutputMode) globals.output_mode) {
         case OUTPUT_BITS: {
             inner_write(fout, magic, ARRLEN(magic));
         } break;
         case OUTPUT_DEBUG: {
-            fprintf(fout, "MAGIC\n");
+            inner_printf(fout, "MAGIC\n");
         } break;
     }
 }
 
-byte read_header(FILE *fin) {
+byte read_header(CioReader *fin) {
     byte i = 0;
     byte ret = 1;
     while (i < ARRLEN(magic)) {
@@ -211,16 +238,15 @@ byte read_header(FILE *fin) {
     return ret;
 }
 
-void output_flush(FILE *fout) {
+void output_flush(CioWriter *fout) {
     switch ((OutputMode) globals.output_mode) {
         case OUTPUT_BITS: {
-            const byte buf = globals.outbuf;
-            inner_write(fout, &buf, 1);
+            cio_put(fout, globals.outbuf);
             globals.outbuf = 0;
             globals.outbuf_size = 0;
         } break;
         case OUTPUT_DEBUG: {
-            fprintf(fout, "EOF\n");
+            inner_printf(fout, "EOF\n");
         } break;
     }
 }
@@ -233,7 +259,9 @@ halfword lzw_step(byte b, byte *first_round) {
         return b;
     } else {
         const halfword len = table_len();
+        PROF_BEGIN(prof_find);
         const halfword new_symbol = table_find_or_add_symbol(curr_symbol, b);
+        PROF_END(prof_find);
         if (new_symbol < len) {
             table_write_curr_symbol(new_symbol);
         } else {
@@ -244,13 +272,14 @@ halfword lzw_step(byte b, byte *first_round) {
 }
 
 // TODO: Emmit Escape to reset symbol_table
-int compress(FILE *fin, FILE *fout) {
+int compress(CioReader *fin, CioWriter *fout) {
     byte first_round = 1;
+    const byte *data;
+    size_t n;
     output_header(fout);
-    while (!feof(fin)) {
-        halfword n = inner_read(fin, readbuf, ARRLEN(readbuf));
-        for (halfword i = 0; i < n; i += 1) {
-            const byte b = readbuf[i];
+    while ((n = cio_read(fin, &data)) > 0) {
+        for (size_t i = 0; i < n; i += 1) {
+            const byte b = data[i];
             const halfword len = table_len();
             const halfword curr_symbol = table_curr_symbol();
             const halfword new_symbol = lzw_step(b, &first_round);
@@ -259,7 +288,9 @@ int compress(FILE *fin, FILE *fout) {
             if (new_symbol < len) {
                 // Empty
             } else {
+                PROF_BEGIN(prof_output);
                 output_symbol(fout, curr_symbol);
+                PROF_END(prof_output);
             }
         }
     }
@@ -268,7 +299,7 @@ int compress(FILE *fin, FILE *fout) {
     return 0;
 }
 
-void decompress_symbol_rec(FILE *fout, halfword s, byte *inout_first_round) {
+void decompress_symbol_rec(CioWriter *fout, halfword s, byte *inout_first_round) {
     assert(s != 0x100);
     byte b = (byte) s;
     if (0x100 < s) {
@@ -276,11 +307,11 @@ void decompress_symbol_rec(FILE *fout, halfword s, byte *inout_first_round) {
         decompress_symbol_rec(fout, def.head, inout_first_round);
         b = def.follow;
     }
-    inner_write(fout, &b, 1);
+    cio_put(fout, b);
     lzw_step(b, inout_first_round);
 }
 
-void decompress_symbol(FILE *fout, halfword s, byte *inout_first_round) {
+void decompress_symbol(CioWriter *fout, halfword s, byte *inout_first_round) {
     if (s == 0x100) {
         symbol_table_meta_size = 1;
         symbol_table_last_size = 1;
@@ -288,43 +319,81 @@ void decompress_symbol(FILE *fout, halfword s, byte *inout_first_round) {
     }
 
     byte b = (byte) s;
-    if (0x100 < s) {
+    if (s == table_len()) {
+        // Note: `s` was added by its own first byte (KwKwK):
+        // it is the previous symbol followed by its first byte
+        const halfword prev = table_curr_symbol();
+        halfword first = prev;
+        while (0x100 < first) {
+            first = table_get_symbol(first).head;
+        }
+        decompress_symbol_rec(fout, prev, inout_first_round);
+        b = (byte) first;
+    } else if (0x100 < s) {
         const SymbolDef def = table_get_symbol(s);
         decompress_symbol_rec(fout, def.head, inout_first_round);
         b = def.follow;
     }
-    inner_write(fout, &b, 1);
+    cio_put(fout, b);
     lzw_step(b, inout_first_round);
 }
 
-int decompress(FILE *fin, FILE *fout) {
-    halfword buf = 0;
+int decompress(CioReader *fin, CioWriter *fout) {
+    // Note: the bits left over (less than a symbol) and 8 new ones overflow a halfword above 9 bits
+    word buf = 0;
     halfword buf_size = 0;
     byte first_round = 1;
+    const byte *data;
+    size_t n;
     assert(read_header(fin));
-    while (!feof(fin)) {
-        halfword n = inner_read(fin, readbuf, ARRLEN(readbuf));
-        for (halfword i = 0; i < n; i += 1) {
-            const byte by = readbuf[i];
+    while ((n = cio_read(fin, &data)) > 0) {
+        for (size_t i = 0; i < n; i += 1) {
+            const byte by = data[i];
             buf |= (by << buf_size);
             buf_size += 8;
-            const halfword num_bits = table_numbits();
+            /* Note: before the output, the compressor had added this symbol
+             * and the one starting with the next byte, both still missing here
+             */
+            const halfword num_bits = 9 + msb((table_len() + 2) >> 8);
             if (buf_size < num_bits) {
                 continue;
             } else {
                 halfword s = buf & ((1 << num_bits) - 1);
                 buf >>= num_bits;
                 buf_size -= num_bits;
+                PROF_BEGIN(prof_decompress);
                 decompress_symbol(fout, s, &first_round);
+                PROF_END(prof_decompress);
             }
         }
     }
+    {
+        // Note: the last symbol adds nothing, so it may be a bit shorter (the padding is less than a symbol)
+        const halfword num_bits = 9 + msb((table_len() + 1) >> 8);
+        if (!first_round && num_bits <= buf_size) {
+            decompress_symbol(fout, buf & ((1 << num_bits) - 1), &first_round);
+        }
+    }
     return 0;
 }
 
+// Note: the benchmarks include this file, without `main`
+#ifndef HASHI_AUCOMPRESS_NO_MAIN
 int main(int argc, char **argv) {
-    FILE *fin = stdin;
-    FILE *fout = stdout;
+    CioReader fin;
+    CioWriter fout;
+    byte decompressing = 0;
+    byte profile = 0;
+    int ret;
+
+    for (int i = 1; i < argc; i += 1) {
+        if (strcmp(argv[i], "-d") == 0) {
+            decompressing = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = 1;
+        }
+    }
+    prof_start();
 
     globals = (struct GlobalState){
         .output_mode = OUTPUT_BITS,
@@ -332,9 +401,29 @@ int main(int argc, char **argv) {
         .outbuf_size = 0,
     };
 
-    if (1 < argc && argv[1][0] == '-' && argv[1][1] == 'd' && argv[1][2] == '\0') {
-        return decompress(fin, fout);
+    if (cio_reader_open(&fin, STDIN_FILENO) != 0 || cio_writer_open(&fout, STDOUT_FILENO) != 0) {
+        perror("aucompress");
+        return 1;
+    }
+
+    if (decompressing) {
+        ret = decompress(&fin, &fout);
     } else {
-        return compress(fin, fout);
+        ret = compress(&fin, &fout);
     }
+    if (fin.error != 0) {
+        fprintf(stderr, "aucompress: stdin: %s\n", strerror(fin.error));
+        ret = 1;
+    }
+
+    if (cio_writer_close(&fout) != 0) {
+        perror("aucompress");
+        ret = 1;
+    }
+    cio_reader_close(&fin);
+    if (profile) {
+        prof_report();
+    }
+    return ret;
 }
+#endif /* HASHI_AUCOMPRESS_NO_MAIN */
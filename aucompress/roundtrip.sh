@@ -0,0 +1,47 @@
+#!/bin/sh
+
+# Round trip test of aucompress (`./aucompress/roundtrip.sh [aucompress binary]`):
+# compresses and decompresses back, comparing with the input,
+# - every file of this repository;
+# - every prefix of COPYING up to 1200 bytes, and then every 61 bytes up to 8000,
+#   crossing the 9 to 10, 10 to 11 and 11 to 12 bits codes (the last symbol included);
+# - runs of one and of two letters (KwKwK: codes used by the step that adds them).
+# Inputs with 0 bytes or longer than about 64 KiB are not supported yet.
+
+set -e
+
+bin=${1:-./outbin/aucompress}
+tmp=$(mktemp -d)
+trap 'rm -rf "${tmp}"' EXIT
+failed=0
+
+check() {
+    if ! { "${bin}" < "$1" > "${tmp}/z" && "${bin}" -d < "${tmp}/z" > "${tmp}/out"; } 2> /dev/null \
+        || ! cmp -s "$1" "${tmp}/out"; then
+        echo "FAIL: $2" >&2
+        failed=1
+    fi
+}
+
+for f in COPYING readme.md */*.c */*.h; do
+    check "${f}" "${f}"
+done
+
+n=1
+while [ "${n}" -le 8000 ]; do
+    head -c "${n}" COPYING > "${tmp}/in"
+    check "${tmp}/in" "COPYING, first ${n} bytes"
+    if [ "${n}" -lt 1200 ]; then n=$((n + 1)); else n=$((n + 61)); fi
+done
+
+for run in a ab; do
+    for n in 1 2 3 4 5 10 100 1000 5000; do
+        yes "${run}" | tr -d '\n' | head -c $((n * ${#run})) > "${tmp}/in"
+        check "${tmp}/in" "${n} times '${run}'"
+    done
+done
+
+if [ "${failed}" -ne 0 ]; then
+    exit 1
+fi
+echo "roundtrip: ok"
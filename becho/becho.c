@@ -1,6 +1,12 @@
 /* becho (binary echo)
  *
  * Reads stdin and echos decoded utf-8 characters.
+ * Use flag `-s` to only report the invalid utf-8 (summary mode).
+ * Use flag `-H [threads]` to count codepoints, blocks and lengths (histogram mode).
+ * Use flag `-c from:to` to convert between utf-8, utf-16 and utf-32 (transcoding mode).
+ * Use flag `--profile` (before the others) to print where the time went on stderr
+ * (see `cutils_prof.h`).
+ * Decoding is done by `utf8.h`, input and output by `cutils_io.h`.
  *
  * Copyright (C) 2023, 2026 Daniel K Hashimoto
  *
@@ -17,81 +23,977 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+/* Note: the histogram mode (`-H`) uses threads, and the input is mapped, which is POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HASHI_UTF8_IMPLEMENTATION
+#include "utf8.h"
+
+#define HASHI_CUTILS_IO_IMPLEMENTATION
+#include "../cutils_io.h"
+
+#define HASHI_CUTILS_PROF_IMPLEMENTATION
+#include "../cutils_prof.h"
 
 typedef unsigned char byte;
 
-int main(void) {
-    int chr;
-    unsigned int codepoint = 0;
-    unsigned int last_codepoint = 0;
-    byte utf8_bytes_left = 0;
-    while ((chr = getchar()) != EOF) {
-        const byte c = (unsigned char) chr;
-        printf("%3hhu 0x%02hhX 0b%01hhd%01hhd%01hhd%01hhd_%01hhd%01hhd%01hhd%01hhd\n",
-            c, c,
-            (c >> 7)&1, (c >> 6)&1, (c >> 5)&1, (c >> 4)&1,
-            (c >> 3)&1, (c >> 2)&1, (c >> 1)&1, (c >> 0)&1
-        );
-        if ( utf8_bytes_left > 0 ) {
-            if ( (c & 0x80) == 0x80 && (c & 0x40) == 0x00 ) {
-                codepoint = (codepoint << 6) | (c & 0x7F);
-                utf8_bytes_left -= 1;
-                if ( utf8_bytes_left == 0 ) {
-                    if (codepoint > 0xFFFF) {
-                        printf("=> U+%04X_%04X\n",
-                            (codepoint >> 16), (codepoint & 0xFFFF)
-                        );
-                    } else if ( 0xD800 <= codepoint && codepoint < 0xDC00 ) {
-                        printf("=> U+%04X (HIGH)\n", codepoint);
-                    } else if ( 0xDC00 <= codepoint && codepoint < 0xE000 ) {
-                        unsigned long long int bigcode =
-                            0x10000 + (
-                            (((unsigned long long int) (last_codepoint & 0x03FF)) << 10)
-                            | (codepoint & 0x03FF)
-                        );
-                        printf("=> U+%04X (LOW): U+%04llX_%04llX\n",
-                            codepoint, (bigcode >> 16), (bigcode & 0xFFFF)
-                        );
-                    } else {
-                        printf("=> U+%04X\n", codepoint);
-                    }
-                }
+/* Note: every input byte prints as one fixed size line,
+ * "255 0xFF 0b1111_1111\n", precomputed for all 256 bytes.
+ */
+#define BYTE_LINE_LEN 21
+#define IN_BUF_LEN 0x10000
+#define MSG_MAX_LEN 0x80
+
+static char byte_lines[0x100][BYTE_LINE_LEN];
+
+static byte inbuf[IN_BUF_LEN];
+
+static CioReader input;
+static CioWriter out;
+
+// Note: the histogram threads are timed as a whole, from the main thread
+PROF_REGION(prof_read, "read");
+PROF_REGION(prof_decode, "decode loop");
+PROF_REGION(prof_encode, "encode");
+
+void make_byte_lines(void) {
+    for (unsigned int c = 0; c < 0x100; c += 1) {
+        char *line = byte_lines[c];
+        static const char hex[] = "0123456789ABCDEF";
+        line[0] = c < 100 ? ' ' : (char) ('0' + c / 100);
+        line[1] = c < 10 ? ' ' : (char) ('0' + (c / 10) % 10);
+        line[2] = (char) ('0' + c % 10);
+        line[3] = ' ';
+        line[4] = '0';
+        line[5] = 'x';
+        line[6] = hex[c >> 4];
+        line[7] = hex[c & 0xF];
+        line[8] = ' ';
+        line[9] = '0';
+        line[10] = 'b';
+        for (byte i = 0; i < 4; i += 1) {
+            line[11 + i] = (char) ('0' + ((c >> (7 - i)) & 1));
+            line[16 + i] = (char) ('0' + ((c >> (3 - i)) & 1));
+        }
+        line[15] = '_';
+        line[20] = '\n';
+    }
+}
+
+static inline
+void out_flush(void) {
+    cio_flush(&out);
+}
+
+// Note: the check is inlined, echo mode reserves for every byte
+static inline
+void out_reserve(size_t len) {
+    if (CIO_BUF_LEN - out.len < len) {
+        cio_flush(&out);
+    }
+}
+
+static inline
+void out_byte_line(byte c) {
+    memcpy(out.buf + out.len, byte_lines[c], BYTE_LINE_LEN);
+    out.len += BYTE_LINE_LEN;
+}
+
+/* Note: after a read loop, prints the read error of stdin (if any), returning 1 */
+int read_failed(void) {
+    if ( input.error != 0 ) {
+        out_flush();
+        fprintf(stderr, "becho: stdin: %s\n", strerror(input.error));
+        return 1;
+    }
+    return 0;
+}
+
+#define out_msg(...) do { \
+    const int n = snprintf((char *) (out.buf + out.len), MSG_MAX_LEN, __VA_ARGS__); \
+    out.len += (size_t) n; \
+} while(0)
+
+Utf8State decoder;
+// Note: the last high surrogate, to show pairs (as in CESU-8)
+uint32_t last_high;
+
+void echo_status(const Utf8Status st) {
+    const uint32_t codepoint = decoder.codepoint;
+    switch (st) {
+        case UTF8_OK:
+            if ( decoder.len == 1 ) {
+                // Note: ASCII
+            } else if ( codepoint > 0xFFFF ) {
+                out_msg("=> U+%04X_%04X\n", (codepoint >> 16), (codepoint & 0xFFFF));
+            } else {
+                out_msg("=> U+%04X\n", codepoint);
+            }
+            break;
+        case UTF8_MORE:
+            break;
+        case UTF8_SURROGATE:
+            if ( codepoint < 0xDC00 ) {
+                out_msg("=> U+%04X (HIGH)\n", codepoint);
+                last_high = codepoint;
             } else {
-                printf("=> Utf8 ERROR: Starting bits are weird\n");
-                last_codepoint = codepoint;
-                codepoint = 0;
-                utf8_bytes_left = 0;
+                const uint32_t bigcode = 0x10000 + (((last_high & 0x03FF) << 10) | (codepoint & 0x03FF));
+                out_msg("=> U+%04X (LOW): U+%04X_%04X\n",
+                    codepoint, (bigcode >> 16), (bigcode & 0xFFFF)
+                );
+            }
+            break;
+        case UTF8_OVERLONG:
+            out_msg("=> Utf8 ERROR: overlong U+%04X\n", codepoint);
+            break;
+        case UTF8_TOO_LARGE:
+            out_msg("=> Utf8 ERROR: too large U+%04X_%04X\n", (codepoint >> 16), (codepoint & 0xFFFF));
+            break;
+        case UTF8_UNEXPECTED_CONT:
+            out_msg("=> Utf8 ERROR: unexpected continuation byte\n");
+            break;
+        case UTF8_INVALID_BYTE:
+            out_msg("=> Utf8 ERROR: invalid byte\n");
+            break;
+        case UTF8_TRUNCATED:
+            out_msg("=> Utf8 ERROR: truncated character\n");
+            break;
+    }
+}
+
+void echo_byte(const byte c) {
+    Utf8Status st;
+    out_reserve(BYTE_LINE_LEN + 2 * MSG_MAX_LEN);
+    out_byte_line(c);
+    st = utf8_decode_byte(&decoder, c);
+    if ( st == UTF8_TRUNCATED ) {
+        // Note: `c` starts (or is) the next character
+        echo_status(st);
+        st = utf8_decode_byte(&decoder, c);
+    }
+    echo_status(st);
+}
+
+/* Summary mode (`-s`): validates utf-8 and reports only the problems,
+ * one line per offset (of the character's first byte).
+ */
+struct {
+    Utf8State s;
+    size_t errors;
+    size_t overlongs;
+    size_t surrogates;
+} validator;
+
+void report(const Utf8Status st, const size_t start) {
+    const uint32_t codepoint = validator.s.codepoint;
+    out_reserve(MSG_MAX_LEN);
+    switch (st) {
+        case UTF8_OK:
+        case UTF8_MORE:
+            break;
+        case UTF8_OVERLONG:
+            out_msg("%zu: overlong U+%04X\n", start, codepoint);
+            validator.overlongs += 1;
+            break;
+        case UTF8_SURROGATE:
+            out_msg("%zu: surrogate U+%04X\n", start, codepoint);
+            validator.surrogates += 1;
+            break;
+        case UTF8_TOO_LARGE:
+            out_msg("%zu: too large U+%04X_%04X\n", start, codepoint >> 16, codepoint & 0xFFFF);
+            validator.errors += 1;
+            break;
+        case UTF8_UNEXPECTED_CONT:
+            out_msg("%zu: unexpected continuation byte 0x%02X\n", start, codepoint);
+            validator.errors += 1;
+            break;
+        case UTF8_INVALID_BYTE:
+            out_msg("%zu: invalid byte 0x%02X\n", start, codepoint);
+            validator.errors += 1;
+            break;
+        case UTF8_TRUNCATED:
+            out_msg("%zu: truncated sequence\n", start);
+            validator.errors += 1;
+            break;
+    }
+}
+
+void validate(const byte buf[], const size_t len, const size_t offset) {
+    size_t i = 0;
+    while (i < len) {
+        Utf8Status st;
+        i += utf8_validate(&validator.s, buf + i, len - i, &st);
+        if ( UTF8_IS_PROBLEM(st) ) {
+            report(st, (offset + i) - validator.s.len);
+        }
+    }
+}
+
+int summary(void) {
+    size_t offset = 0;
+    const byte *chunk;
+    size_t len;
+
+    utf8_init(&validator.s);
+    validator.errors = 0;
+    validator.overlongs = 0;
+    validator.surrogates = 0;
+
+    for (;;) {
+        PROF_BEGIN(prof_read);
+        len = cio_read(&input, &chunk);
+        PROF_END(prof_read);
+        if ( len == 0 ) {
+            break;
+        }
+        PROF_BEGIN(prof_decode);
+        validate(chunk, len, offset);
+        PROF_END(prof_decode);
+        offset += len;
+    }
+    if ( read_failed() ) {
+        return 1;
+    }
+    if ( utf8_finish(&validator.s) == UTF8_TRUNCATED ) {
+        report(UTF8_TRUNCATED, offset - validator.s.len);
+    }
+    out_reserve(MSG_MAX_LEN);
+    out_msg("=> %zu bytes: %zu errors, %zu overlongs, %zu surrogates\n",
+        offset, validator.errors, validator.overlongs, validator.surrogates
+    );
+    out_flush();
+    return validator.errors + validator.overlongs + validator.surrogates > 0;
+}
+
+/* Histogram mode (`-H [threads]`): counts the characters per codepoint,
+ * per unicode block and per encoded length, and the problems.
+ * The input is read in batches, each batch is split in one chunk per thread
+ * and each thread counts into its own histogram, merged at the end.
+ */
+#define HIST_BATCH_LEN 0x4000000
+#define HIST_MAX_THREADS 64
+#define HIST_CODEPOINTS 0x110000
+#define HIST_PLANES 0x11
+
+typedef struct {
+    const byte *data;
+    size_t len;
+    uint64_t *codepoints;
+    uint64_t lengths[UTF8_MAX_LEN + 1];
+    uint64_t problems[UTF8_TRUNCATED + 1];
+} Histogram;
+
+/* Note: the main blocks of Blocks.txt (Unicode 15.1),
+ * everything else is counted per plane
+ */
+static const struct {
+    uint32_t first;
+    uint32_t last;
+    const char *name;
+} blocks[] = {
+    { 0x0000, 0x007F, "Basic Latin" },
+    { 0x0080, 0x00FF, "Latin-1 Supplement" },
+    { 0x0100, 0x017F, "Latin Extended-A" },
+    { 0x0180, 0x024F, "Latin Extended-B" },
+    { 0x0250, 0x02AF, "IPA Extensions" },
+    { 0x02B0, 0x02FF, "Spacing Modifier Letters" },
+    { 0x0300, 0x036F, "Combining Diacritical Marks" },
+    { 0x0370, 0x03FF, "Greek and Coptic" },
+    { 0x0400, 0x04FF, "Cyrillic" },
+    { 0x0500, 0x052F, "Cyrillic Supplement" },
+    { 0x0530, 0x058F, "Armenian" },
+    { 0x0590, 0x05FF, "Hebrew" },
+    { 0x0600, 0x06FF, "Arabic" },
+    { 0x0700, 0x074F, "Syriac" },
+    { 0x0900, 0x097F, "Devanagari" },
+    { 0x0980, 0x09FF, "Bengali" },
+    { 0x0A00, 0x0A7F, "Gurmukhi" },
+    { 0x0A80, 0x0AFF, "Gujarati" },
+    { 0x0B80, 0x0BFF, "Tamil" },
+    { 0x0C00, 0x0C7F, "Telugu" },
+    { 0x0C80, 0x0CFF, "Kannada" },
+    { 0x0D00, 0x0D7F, "Malayalam" },
+    { 0x0E00, 0x0E7F, "Thai" },
+    { 0x0E80, 0x0EFF, "Lao" },
+    { 0x0F00, 0x0FFF, "Tibetan" },
+    { 0x1000, 0x109F, "Myanmar" },
+    { 0x10A0, 0x10FF, "Georgian" },
+    { 0x1100, 0x11FF, "Hangul Jamo" },
+    { 0x1E00, 0x1EFF, "Latin Extended Additional" },
+    { 0x1F00, 0x1FFF, "Greek Extended" },
+    { 0x2000, 0x206F, "General Punctuation" },
+    { 0x2070, 0x209F, "Superscripts and Subscripts" },
+    { 0x20A0, 0x20CF, "Currency Symbols" },
+    { 0x2100, 0x214F, "Letterlike Symbols" },
+    { 0x2150, 0x218F, "Number Forms" },
+    { 0x2190, 0x21FF, "Arrows" },
+    { 0x2200, 0x22FF, "Mathematical Operators" },
+    { 0x2300, 0x23FF, "Miscellaneous Technical" },
+    { 0x2460, 0x24FF, "Enclosed Alphanumerics" },
+    { 0x2500, 0x257F, "Box Drawing" },
+    { 0x2580, 0x259F, "Block Elements" },
+    { 0x25A0, 0x25FF, "Geometric Shapes" },
+    { 0x2600, 0x26FF, "Miscellaneous Symbols" },
+    { 0x2700, 0x27BF, "Dingbats" },
+    { 0x2800, 0x28FF, "Braille Patterns" },
+    { 0x2E80, 0x2EFF, "CJK Radicals Supplement" },
+    { 0x3000, 0x303F, "CJK Symbols and Punctuation" },
+    { 0x3040, 0x309F, "Hiragana" },
+    { 0x30A0, 0x30FF, "Katakana" },
+    { 0x3100, 0x312F, "Bopomofo" },
+    { 0x3130, 0x318F, "Hangul Compatibility Jamo" },
+    { 0x3400, 0x4DBF, "CJK Unified Ideographs Extension A" },
+    { 0x4E00, 0x9FFF, "CJK Unified Ideographs" },
+    { 0xA000, 0xA48F, "Yi Syllables" },
+    { 0xAC00, 0xD7AF, "Hangul Syllables" },
+    { 0xE000, 0xF8FF, "Private Use Area" },
+    { 0xF900, 0xFAFF, "CJK Compatibility Ideographs" },
+    { 0xFB00, 0xFB4F, "Alphabetic Presentation Forms" },
+    { 0xFB50, 0xFDFF, "Arabic Presentation Forms-A" },
+    { 0xFE00, 0xFE0F, "Variation Selectors" },
+    { 0xFE30, 0xFE4F, "CJK Compatibility Forms" },
+    { 0xFE70, 0xFEFF, "Arabic Presentation Forms-B" },
+    { 0xFF00, 0xFFEF, "Halfwidth and Fullwidth Forms" },
+    { 0xFFF0, 0xFFFF, "Specials" },
+    { 0x1D400, 0x1D7FF, "Mathematical Alphanumeric Symbols" },
+    { 0x1F000, 0x1F02F, "Mahjong Tiles" },
+    { 0x1F100, 0x1F1FF, "Enclosed Alphanumeric Supplement" },
+    { 0x1F300, 0x1F5FF, "Miscellaneous Symbols and Pictographs" },
+    { 0x1F600, 0x1F64F, "Emoticons" },
+    { 0x1F680, 0x1F6FF, "Transport and Map Symbols" },
+    { 0x1F900, 0x1F9FF, "Supplemental Symbols and Pictographs" },
+    { 0x20000, 0x2A6DF, "CJK Unified Ideographs Extension B" },
+    { 0xE0000, 0xE007F, "Tags" },
+    { 0xF0000, 0xFFFFF, "Supplementary Private Use Area-A" },
+    { 0x100000, 0x10FFFF, "Supplementary Private Use Area-B" },
+};
+
+#define BLOCKS_LEN (sizeof(blocks)/sizeof(blocks[0]))
+
+void *hist_count(void *arg) {
+    Histogram *h = arg;
+    Utf8State s;
+
+    utf8_init(&s);
+    for (size_t i = 0; i < h->len; i += 1) {
+        Utf8Status st = utf8_decode_byte(&s, h->data[i]);
+        if ( st == UTF8_TRUNCATED ) {
+            h->problems[st] += 1;
+            st = utf8_decode_byte(&s, h->data[i]);
+        }
+        if ( st == UTF8_OK ) {
+            h->codepoints[s.codepoint] += 1;
+            h->lengths[s.len] += 1;
+        } else if ( UTF8_IS_PROBLEM(st) ) {
+            h->problems[st] += 1;
+        }
+    }
+    if ( utf8_finish(&s) == UTF8_TRUNCATED ) {
+        h->problems[UTF8_TRUNCATED] += 1;
+    }
+    return NULL;
+}
+
+/* Note: moves `at` past (at most 3) continuation bytes.
+ * Then the decoder is always ready for a new character at `at`
+ * (or it is truncated there), so chunks split there count the same
+ * as a single pass over the whole input.
+ */
+size_t hist_resync(const byte data[], const size_t len, size_t at) {
+    for (byte k = 0; k < UTF8_MAX_LEN - 1; k += 1) {
+        if ( at >= len || (data[at] & 0xC0) != 0x80 ) {
+            break;
+        }
+        at += 1;
+    }
+    return at;
+}
+
+void out_codepoint(const uint32_t codepoint) {
+    if ( codepoint > 0xFFFF ) {
+        out_msg("U+%04X_%04X", (codepoint >> 16), (codepoint & 0xFFFF));
+    } else {
+        out_msg("U+%04X", codepoint);
+    }
+}
+
+static const char *problem_names[UTF8_TRUNCATED + 1] = {
+    [UTF8_OK] = "ok",
+    [UTF8_MORE] = "more",
+    [UTF8_OVERLONG] = "overlong",
+    [UTF8_SURROGATE] = "surrogate",
+    [UTF8_TOO_LARGE] = "too large",
+    [UTF8_UNEXPECTED_CONT] = "unexpected continuation byte",
+    [UTF8_INVALID_BYTE] = "invalid byte",
+    [UTF8_TRUNCATED] = "truncated sequence",
+};
+
+void hist_print(const Histogram *h) {
+    uint64_t planes[HIST_PLANES] = { 0 };
+
+    out_reserve(MSG_MAX_LEN);
+    out_msg("=> lengths\n");
+    for (byte l = 1; l <= UTF8_MAX_LEN; l += 1) {
+        out_reserve(MSG_MAX_LEN);
+        out_msg("%u: %llu\n", l, (unsigned long long int) h->lengths[l]);
+    }
+
+    out_reserve(MSG_MAX_LEN);
+    out_msg("=> problems\n");
+    for (byte st = UTF8_OVERLONG; st <= UTF8_TRUNCATED; st += 1) {
+        out_reserve(MSG_MAX_LEN);
+        out_msg("%s: %llu\n", problem_names[st], (unsigned long long int) h->problems[st]);
+    }
+
+    for (uint32_t cp = 0; cp < HIST_CODEPOINTS; cp += 1) {
+        planes[cp >> 16] += h->codepoints[cp];
+    }
+    out_reserve(MSG_MAX_LEN);
+    out_msg("=> blocks\n");
+    for (size_t b = 0; b < BLOCKS_LEN; b += 1) {
+        uint64_t count = 0;
+        for (uint32_t cp = blocks[b].first; cp <= blocks[b].last; cp += 1) {
+            count += h->codepoints[cp];
+        }
+        planes[blocks[b].first >> 16] -= count;
+        if ( count > 0 ) {
+            out_reserve(4 * MSG_MAX_LEN);
+            out_codepoint(blocks[b].first);
+            out_msg("..");
+            out_codepoint(blocks[b].last);
+            out_msg(": %llu %s\n", (unsigned long long int) count, blocks[b].name);
+        }
+    }
+    for (byte p = 0; p < HIST_PLANES; p += 1) {
+        if ( planes[p] > 0 ) {
+            out_reserve(MSG_MAX_LEN);
+            out_msg("plane %u (other blocks): %llu\n", p, (unsigned long long int) planes[p]);
+        }
+    }
+
+    out_reserve(MSG_MAX_LEN);
+    out_msg("=> codepoints\n");
+    for (uint32_t cp = 0; cp < HIST_CODEPOINTS; cp += 1) {
+        if ( h->codepoints[cp] > 0 ) {
+            out_reserve(2 * MSG_MAX_LEN);
+            out_codepoint(cp);
+            out_msg(": %llu\n", (unsigned long long int) h->codepoints[cp]);
+        }
+    }
+}
+
+int histogram(const size_t threads) {
+    Histogram hists[HIST_MAX_THREADS];
+    pthread_t ids[HIST_MAX_THREADS];
+    byte *batch = malloc(HIST_BATCH_LEN);
+    size_t carry = 0;
+    int eof = 0;
+
+    if ( batch == NULL ) {
+        fprintf(stderr, "Could not allocate the input batch\n");
+        return 1;
+    }
+    for (size_t t = 0; t < threads; t += 1) {
+        memset(&hists[t], 0, sizeof(hists[t]));
+        hists[t].codepoints = calloc(HIST_CODEPOINTS, sizeof(hists[t].codepoints[0]));
+        if ( hists[t].codepoints == NULL ) {
+            fprintf(stderr, "Could not allocate the histograms\n");
+            return 1;
+        }
+    }
+
+    while (!eof) {
+        size_t len = carry;
+        size_t end;
+        size_t start = 0;
+
+        PROF_BEGIN(prof_read);
+        len += cio_read_into(&input, batch + len, HIST_BATCH_LEN - len);
+        PROF_END(prof_read);
+        eof = len < HIST_BATCH_LEN;
+        // Note: the last (at most 3) bytes might be an incomplete character, they go to the next batch
+        end = eof ? len : hist_resync(batch, len, len >= UTF8_MAX_LEN - 1 ? len - (UTF8_MAX_LEN - 1) : 0);
+
+        PROF_BEGIN(prof_decode);
+        for (size_t t = 0; t < threads; t += 1) {
+            size_t stop = (t + 1 == threads) ? end : hist_resync(batch, end, (end / threads) * (t + 1));
+            if ( stop < start ) {
+                stop = start;
+            }
+            hists[t].data = batch + start;
+            hists[t].len = stop - start;
+            start = stop;
+            if ( pthread_create(&ids[t], NULL, hist_count, &hists[t]) != 0 ) {
+                fprintf(stderr, "Could not create thread\n");
+                return 1;
             }
+        }
+        for (size_t t = 0; t < threads; t += 1) {
+            pthread_join(ids[t], NULL);
+        }
+        PROF_END(prof_decode);
+
+        carry = len - end;
+        memmove(batch, batch + end, carry);
+    }
+    if ( read_failed() ) {
+        for (size_t t = 0; t < threads; t += 1) {
+            free(hists[t].codepoints);
+        }
+        free(batch);
+        return 1;
+    }
+
+    for (size_t t = 1; t < threads; t += 1) {
+        for (uint32_t cp = 0; cp < HIST_CODEPOINTS; cp += 1) {
+            hists[0].codepoints[cp] += hists[t].codepoints[cp];
+        }
+        for (byte l = 0; l <= UTF8_MAX_LEN; l += 1) {
+            hists[0].lengths[l] += hists[t].lengths[l];
+        }
+        for (byte st = 0; st <= UTF8_TRUNCATED; st += 1) {
+            hists[0].problems[st] += hists[t].problems[st];
+        }
+        free(hists[t].codepoints);
+    }
+
+    hist_print(&hists[0]);
+    out_flush();
+    free(hists[0].codepoints);
+    free(batch);
+    return 0;
+}
+
+/* Transcoding mode (`-c from:to`): converts between utf-8, utf-16 and utf-32.
+ * Each input block is decoded into codepoints, then encoded,
+ * stopping (with the offset on stderr) at the first invalid character.
+ * Runs of ascii (and, for utf-16, of BMP) go 8 or 16 characters at a time.
+ */
+typedef enum {
+    ENC_UTF8 = 0,
+    ENC_UTF16LE,
+    ENC_UTF16BE,
+    ENC_UTF32LE,
+    ENC_UTF32BE,
+    ENC_LEN,
+} Encoding;
+
+static const char *encoding_names[ENC_LEN] = {
+    [ENC_UTF8] = "utf8",
+    [ENC_UTF16LE] = "utf16le",
+    [ENC_UTF16BE] = "utf16be",
+    [ENC_UTF32LE] = "utf32le",
+    [ENC_UTF32BE] = "utf32be",
+};
+
+static uint32_t codepoints[IN_BUF_LEN];
+
+/* Note: decoders return how many bytes were decoded, stopping before
+ * an invalid character (setting `*error`) or an incomplete one at the end
+ */
+size_t dec_utf8(const byte in[], const size_t len, uint32_t cps[], size_t *count, const char **error) {
+    Utf8State s;
+    Utf8Status st;
+    uint64_t k = 0;
+    size_t i;
+
+    utf8_init(&s);
+    i = (size_t) utf8_decode(&s, in, len, cps, &k, &st);
+    *count = (size_t) k;
+    if ( UTF8_IS_PROBLEM(st) ) {
+        *error = problem_names[st];
+        return i - s.len;
+    } else if ( st == UTF8_MORE ) {
+        return i - s.len;
+    }
+    return i;
+}
+
+static inline
+uint32_t load16(const byte p[], const int be) {
+    return be ? (uint32_t) ((p[0] << 8) | p[1]) : (uint32_t) ((p[1] << 8) | p[0]);
+}
+
+size_t dec_utf16(const byte in[], const size_t len, const int be,
+    uint32_t cps[], size_t *count, const char **error) {
+    size_t i = 0;
+    size_t k = 0;
+
+    while (len - i >= 2) {
+#ifdef __SSE2__
+        // Note: 8 code units at a time, while none is a surrogate
+        while (len - i >= 16) {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i v = _mm_loadu_si128((const __m128i *) (const void *) (in + i));
+            if ( be ) {
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            }
+            const __m128i surrogates = _mm_cmpeq_epi16(
+                _mm_and_si128(v, _mm_set1_epi16((short) 0xF800)), _mm_set1_epi16((short) 0xD800)
+            );
+            if ( _mm_movemask_epi8(surrogates) != 0 ) {
+                break;
+            }
+            _mm_storeu_si128((__m128i *) (void *) (cps + k), _mm_unpacklo_epi16(v, zero));
+            _mm_storeu_si128((__m128i *) (void *) (cps + k + 4), _mm_unpackhi_epi16(v, zero));
+            i += 16;
+            k += 8;
+        }
+        if ( len - i < 2 ) {
+            break;
+        }
+#endif
+        const uint32_t u = load16(in + i, be);
+        if ( u < 0xD800 || 0xE000 <= u ) {
+            cps[k] = u;
+            k += 1;
+            i += 2;
+        } else if ( u < 0xDC00 ) {
+            if ( len - i < 4 ) {
+                break;
+            }
+            const uint32_t low = load16(in + i + 2, be);
+            if ( low < 0xDC00 || 0xE000 <= low ) {
+                *error = "unpaired high surrogate";
+                break;
+            }
+            cps[k] = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+            k += 1;
+            i += 4;
         } else {
-            for (byte i = 0x80; i > 0; i >>= 1) {
-                if ( (c & i) == i ) {
-                    utf8_bytes_left += 1;
-                } else {
-                    break;
-                }
+            *error = "unpaired low surrogate";
+            break;
+        }
+    }
+    *count = k;
+    return i;
+}
+
+size_t dec_utf32(const byte in[], const size_t len, const int be,
+    uint32_t cps[], size_t *count, const char **error) {
+    size_t i = 0;
+    size_t k = 0;
+
+    for (; len - i >= 4; i += 4) {
+        const byte *p = in + i;
+        const uint32_t u = be
+            ? ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3]
+            : ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) | ((uint32_t) p[1] << 8) | p[0];
+        if ( 0xD800 <= u && u < 0xE000 ) {
+            *error = problem_names[UTF8_SURROGATE];
+            break;
+        } else if ( u > 0x10FFFF ) {
+            *error = problem_names[UTF8_TOO_LARGE];
+            break;
+        }
+        cps[k] = u;
+        k += 1;
+    }
+    *count = k;
+    return i;
+}
+
+// Note: encoders return how many bytes were written (at most 4 per codepoint)
+size_t enc_utf8(const uint32_t cps[], const size_t count, byte out_bytes[]) {
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < count) {
+#ifdef __SSE2__
+        // Note: 16 ascii characters at a time
+        while (count - i >= 16) {
+            const __m128i *p = (const __m128i *) (const void *) (cps + i);
+            const __m128i v0 = _mm_loadu_si128(p + 0);
+            const __m128i v1 = _mm_loadu_si128(p + 1);
+            const __m128i v2 = _mm_loadu_si128(p + 2);
+            const __m128i v3 = _mm_loadu_si128(p + 3);
+            const __m128i all = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+            const __m128i high = _mm_and_si128(all, _mm_set1_epi32(~0x7F));
+            if ( _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF ) {
+                break;
             }
-            // if ( c == 0xC0 || c == 0xC1 || c > 0xF4 ) {
-            //     printf("=> Utf8 ERROR: starting character is invalid\n");
-            //     utf8_bytes_left = 0;
-            // }
-            if ( (c & 0xFE) == 0xFE ) {
-                printf("=> Utf8 ERROR: starting character is 0xFF or 0xFE\n");
-                utf8_bytes_left = 0;
-            } else if ( utf8_bytes_left > 1 ) {
-                utf8_bytes_left -= 1;
-                byte mask = (1 << (7 - utf8_bytes_left)) - 1;
-                last_codepoint = codepoint;
-                codepoint = c & mask;
-            } else if (utf8_bytes_left == 1) {
-                // Note: in the middle/end of a sequence
-                utf8_bytes_left = 0;
-            } else if (utf8_bytes_left == 0) {
-                // Note: ASCII
-            } else {
-                printf("=> Utf8 ERROR: Starting bits are weird (first byte)\n");
+            _mm_storeu_si128((__m128i *) (void *) (out_bytes + j), _mm_packus_epi16(
+                _mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)
+            ));
+            i += 16;
+            j += 16;
+        }
+        if ( i == count ) {
+            break;
+        }
+#endif
+        const uint32_t cp = cps[i];
+        if ( cp < 0x80 ) {
+            out_bytes[j] = (byte) cp;
+            j += 1;
+        } else if ( cp < 0x800 ) {
+            out_bytes[j + 0] = (byte) (0xC0 | (cp >> 6));
+            out_bytes[j + 1] = (byte) (0x80 | (cp & 0x3F));
+            j += 2;
+        } else if ( cp < 0x10000 ) {
+            out_bytes[j + 0] = (byte) (0xE0 | (cp >> 12));
+            out_bytes[j + 1] = (byte) (0x80 | ((cp >> 6) & 0x3F));
+            out_bytes[j + 2] = (byte) (0x80 | (cp & 0x3F));
+            j += 3;
+        } else {
+            out_bytes[j + 0] = (byte) (0xF0 | (cp >> 18));
+            out_bytes[j + 1] = (byte) (0x80 | ((cp >> 12) & 0x3F));
+            out_bytes[j + 2] = (byte) (0x80 | ((cp >> 6) & 0x3F));
+            out_bytes[j + 3] = (byte) (0x80 | (cp & 0x3F));
+            j += 4;
+        }
+        i += 1;
+    }
+    return j;
+}
+
+static inline
+void store16(byte p[], const uint32_t u, const int be) {
+    p[be ? 0 : 1] = (byte) (u >> 8);
+    p[be ? 1 : 0] = (byte) (u & 0xFF);
+}
+
+size_t enc_utf16(const uint32_t cps[], const size_t count, const int be, byte out_bytes[]) {
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < count) {
+#ifdef __SSE2__
+        // Note: 8 BMP characters at a time (biased by 0x8000 to pack them signed)
+        while (count - i >= 8) {
+            const __m128i *p = (const __m128i *) (const void *) (cps + i);
+            const __m128i v0 = _mm_loadu_si128(p + 0);
+            const __m128i v1 = _mm_loadu_si128(p + 1);
+            const __m128i high = _mm_and_si128(_mm_or_si128(v0, v1), _mm_set1_epi32((int) 0xFFFF0000));
+            if ( _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF ) {
+                break;
+            }
+            const __m128i bias = _mm_set1_epi32(0x8000);
+            __m128i v = _mm_add_epi16(
+                _mm_packs_epi32(_mm_sub_epi32(v0, bias), _mm_sub_epi32(v1, bias)),
+                _mm_set1_epi16((short) 0x8000)
+            );
+            if ( be ) {
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
             }
+            _mm_storeu_si128((__m128i *) (void *) (out_bytes + j), v);
+            i += 8;
+            j += 16;
+        }
+        if ( i == count ) {
+            break;
+        }
+#endif
+        const uint32_t cp = cps[i];
+        if ( cp < 0x10000 ) {
+            store16(out_bytes + j, cp, be);
+            j += 2;
+        } else {
+            store16(out_bytes + j, 0xD800 + ((cp - 0x10000) >> 10), be);
+            store16(out_bytes + j + 2, 0xDC00 + ((cp - 0x10000) & 0x3FF), be);
+            j += 4;
         }
+        i += 1;
     }
+    return j;
+}
+
+size_t enc_utf32(const uint32_t cps[], const size_t count, const int be, byte out_bytes[]) {
+    for (size_t i = 0; i < count; i += 1) {
+        byte *p = out_bytes + 4*i;
+        const uint32_t cp = cps[i];
+        p[be ? 0 : 3] = (byte) (cp >> 24);
+        p[be ? 1 : 2] = (byte) ((cp >> 16) & 0xFF);
+        p[be ? 2 : 1] = (byte) ((cp >> 8) & 0xFF);
+        p[be ? 3 : 0] = (byte) (cp & 0xFF);
+    }
+    return 4*count;
+}
+
+size_t decode(const Encoding from, const byte in[], const size_t len,
+    uint32_t cps[], size_t *count, const char **error) {
+    switch (from) {
+        case ENC_UTF8: return dec_utf8(in, len, cps, count, error);
+        case ENC_UTF16LE: return dec_utf16(in, len, 0, cps, count, error);
+        case ENC_UTF16BE: return dec_utf16(in, len, 1, cps, count, error);
+        case ENC_UTF32LE: return dec_utf32(in, len, 0, cps, count, error);
+        case ENC_UTF32BE: return dec_utf32(in, len, 1, cps, count, error);
+        case ENC_LEN: break;
+    }
+    *count = 0;
+    return 0;
+}
+
+size_t encode(const Encoding to, const uint32_t cps[], const size_t count, byte out_bytes[]) {
+    switch (to) {
+        case ENC_UTF8: return enc_utf8(cps, count, out_bytes);
+        case ENC_UTF16LE: return enc_utf16(cps, count, 0, out_bytes);
+        case ENC_UTF16BE: return enc_utf16(cps, count, 1, out_bytes);
+        case ENC_UTF32LE: return enc_utf32(cps, count, 0, out_bytes);
+        case ENC_UTF32BE: return enc_utf32(cps, count, 1, out_bytes);
+        case ENC_LEN: break;
+    }
+    return 0;
+}
+
+Encoding parse_encoding(const char *name, const size_t len) {
+    for (byte e = 0; e < ENC_LEN; e += 1) {
+        if ( strlen(encoding_names[e]) == len && strncmp(encoding_names[e], name, len) == 0 ) {
+            return (Encoding) e;
+        }
+    }
+    return ENC_LEN;
+}
+
+int transcode(const Encoding from, const Encoding to) {
+    size_t offset = 0;
+    size_t carry = 0;
+    int eof = 0;
+
+    while (!eof) {
+        const char *error = NULL;
+        size_t len = carry;
+        size_t count;
+        size_t used;
+
+        PROF_BEGIN(prof_read);
+        len += cio_read_into(&input, inbuf + len, IN_BUF_LEN - len);
+        PROF_END(prof_read);
+        eof = len < IN_BUF_LEN;
+        if ( read_failed() ) {
+            return 1;
+        }
+
+        PROF_BEGIN(prof_decode);
+        used = decode(from, inbuf, len, codepoints, &count, &error);
+        PROF_END(prof_decode);
+        out_reserve(4 * count);
+        PROF_BEGIN(prof_encode);
+        out.len += encode(to, codepoints, count, out.buf + out.len);
+        PROF_END(prof_encode);
+
+        if ( error == NULL && eof && used < len ) {
+            error = problem_names[UTF8_TRUNCATED];
+        }
+        if ( error != NULL ) {
+            out_flush();
+            fprintf(stderr, "%zu: %s\n", offset + used, error);
+            return 1;
+        }
+
+        // Note: an incomplete character (at most 3 bytes) goes to the next block
+        carry = len - used;
+        memmove(inbuf, inbuf + used, carry);
+        offset += used;
+    }
+    out_flush();
     return 0;
 }
+
+int echo(void) {
+    const byte *chunk;
+    size_t len;
+
+    utf8_init(&decoder);
+    last_high = 0;
+
+    for (;;) {
+        PROF_BEGIN(prof_read);
+        len = cio_read(&input, &chunk);
+        PROF_END(prof_read);
+        if ( len == 0 ) {
+            break;
+        }
+        PROF_BEGIN(prof_decode);
+        for (size_t i = 0; i < len; i += 1) {
+            echo_byte(chunk[i]);
+        }
+        PROF_END(prof_decode);
+    }
+    if ( read_failed() ) {
+        return 1;
+    }
+    if ( utf8_finish(&decoder) == UTF8_TRUNCATED ) {
+        out_reserve(MSG_MAX_LEN);
+        echo_status(UTF8_TRUNCATED);
+    }
+    out_flush();
+    return 0;
+}
+
+int main(const int argc, const char *argv[]) {
+    enum { ECHO, SUMMARY, HISTOGRAM, TRANSCODE } mode = ECHO;
+    long threads = 0;
+    Encoding from = ENC_LEN;
+    Encoding to = ENC_LEN;
+    const char **args = argv;
+    int nargs = argc;
+    uint8_t profile = 0;
+    int ret = 1;
+
+    prof_start();
+    if ( 2 <= nargs && strcmp(args[1], "--profile") == 0 ) {
+        profile = 1;
+        args += 1;
+        nargs -= 1;
+    }
+
+    if ( nargs == 2 && strcmp(args[1], "-s") == 0 ) {
+        mode = SUMMARY;
+    } else if ( 2 <= nargs && nargs <= 3 && strcmp(args[1], "-H") == 0 ) {
+        mode = HISTOGRAM;
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if ( nargs == 3 ) {
+            threads = strtol(args[2], NULL, 10);
+            if ( threads < 1 || threads > HIST_MAX_THREADS ) {
+                fprintf(stderr, "Number of threads should be in 1..%d\n", HIST_MAX_THREADS);
+                return 1;
+            }
+        } else if ( threads < 1 ) {
+            threads = 1;
+        } else if ( threads > HIST_MAX_THREADS ) {
+            threads = HIST_MAX_THREADS;
+        }
+    } else if ( nargs == 3 && strcmp(args[1], "-c") == 0 ) {
+        const char *colon = strchr(args[2], ':');
+        mode = TRANSCODE;
+        from = (colon == NULL) ? ENC_LEN : parse_encoding(args[2], (size_t) (colon - args[2]));
+        to = (colon == NULL) ? ENC_LEN : parse_encoding(colon + 1, strlen(colon + 1));
+        if ( from == ENC_LEN || to == ENC_LEN ) {
+            fprintf(stderr, "Expected from:to, each one of utf8, utf16le, utf16be, utf32le, utf32be\n");
+            return 1;
+        }
+    } else if ( nargs > 1 ) {
+        fprintf(stderr, "usage: %s [--profile] [-s | -H [threads] | -c from:to]\n", argv[0]);
+        return 1;
+    }
+
+    make_byte_lines();
+    if ( cio_reader_open(&input, STDIN_FILENO) != 0 || cio_writer_open(&out, STDOUT_FILENO) != 0 ) {
+        fprintf(stderr, "Could not allocate the buffers\n");
+        return 1;
+    }
+
+    switch (mode) {
+        case ECHO: ret = echo(); break;
+        case SUMMARY: ret = summary(); break;
+        case HISTOGRAM: ret = histogram((size_t) threads); break;
+        case TRANSCODE: ret = transcode(from, to); break;
+    }
+
+    if ( cio_writer_close(&out) != 0 ) {
+        ret = 1;
+    }
+    cio_reader_close(&input);
+    if ( profile ) {
+        prof_report();
+    }
+    return ret;
+}
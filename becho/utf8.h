@@ -0,0 +1,527 @@
+/* utf8
+ *
+ * A library of utf-8 decoding, with a table-driven DFA
+ * (in the style of Bjoern Hoehrmann's decoder).
+ * Besides the invalid bytes, reports overlongs, surrogates
+ * and codepoints above U+10FFFF, still giving their codepoint.
+ * Runs of ascii are skipped 16 (SSE2) or 32 (AVX2) bytes at a time
+ * by the bulk functions; with SSSE3 (or AVX2), `utf8_validate` checks
+ * any text 16 (or 32) bytes at a time with the lookup algorithm
+ * of Keiser and Lemire, rescanning a failing block with the DFA.
+ * To get the implementation of the functions,
+ * define `HASHI_UTF8_IMPLEMENTATION` before including this file.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASHI_UTF8_H_
+#define _HASHI_UTF8_H_
+
+#include <stdint.h>
+
+#define UTF8_MAX_LEN 4
+
+/* Note: the statuses from `UTF8_OVERLONG` onwards are problems,
+ * after them the decoder is ready for a new character.
+ * The first three of them complete a (bad) character,
+ * leaving its value in `Utf8State.codepoint`.
+ */
+typedef enum {
+    UTF8_OK = 0,          // a character is complete (see `codepoint`)
+    UTF8_MORE,            // in the middle of a character
+    UTF8_OVERLONG,        // complete, but should have used less bytes
+    UTF8_SURROGATE,       // complete, but is in U+D800..U+DFFF
+    UTF8_TOO_LARGE,       // complete, but is above U+10FFFF
+    UTF8_UNEXPECTED_CONT, // continuation byte (0x80..0xBF) out of a character
+    UTF8_INVALID_BYTE,    // byte 0xF8..0xFF
+    UTF8_TRUNCATED,       // character cut by this byte, feed it again
+} Utf8Status;
+
+#define UTF8_IS_PROBLEM(status) ((status) >= UTF8_OVERLONG)
+
+/* Note: `len` counts the bytes of the current character
+ * (or the last one, after it is complete),
+ * not counting the byte that gives `UTF8_TRUNCATED`.
+ * For the two single byte problems, `codepoint` is that byte.
+ */
+typedef struct {
+    uint32_t codepoint;
+    uint8_t state;
+    uint8_t len;
+} Utf8State;
+
+void utf8_init(Utf8State *s);
+
+Utf8Status utf8_decode_byte(Utf8State *s, uint8_t c);
+// Note: returns `UTF8_TRUNCATED` if the input ended in the middle of a character
+Utf8Status utf8_finish(Utf8State *s);
+
+/* Bulk functions
+ *
+ * Consume `data` until its end or until a problem, which is left in `*status`
+ * (otherwise `UTF8_OK`, or `UTF8_MORE` if it ended in the middle of a character).
+ * Return how many bytes were consumed: the byte of `UTF8_TRUNCATED` is not.
+ * The character of the problem starts `s->len` bytes before the returned index.
+ *
+ * `utf8_decode` also appends the decoded characters to `out`
+ * (which must have room for `size` codepoints), adding their number to `*count`.
+ */
+uint64_t utf8_validate(Utf8State *s, const uint8_t data[], uint64_t size, Utf8Status *status);
+uint64_t utf8_decode(Utf8State *s, const uint8_t data[], uint64_t size,
+    uint32_t out[], uint64_t *count, Utf8Status *status);
+
+// Note: length of the run of ascii at the start of `data`
+uint64_t utf8_ascii_len(const uint8_t data[], uint64_t size);
+
+#endif /* _HASHI_UTF8_H_ */
+
+#ifdef HASHI_UTF8_IMPLEMENTATION
+#ifndef _HASHI_UTF8_IMPL_
+#define _HASHI_UTF8_IMPL_
+
+/* Resources:
+ * - https://bjoern.hoehrmann.de/utf-8/decoder/dfa/
+ * - RFC 3629 (UTF-8), section 4 (syntax of utf-8 byte sequences)
+ * - J. Keiser, D. Lemire, Validating UTF-8 In Less Than One Instruction Per Byte (2021)
+ */
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define UTF8__BLOCK 32
+#elif defined(__SSSE3__)
+#define UTF8__BLOCK 16
+#endif
+
+/* Note: byte classes
+ *  0: 00..7F     4: C0..C1    8: ED        12: F5..F7
+ *  1: 80..8F     5: C2..DF    9: F0        13: F8..FF
+ *  2: 90..9F     6: E0       10: F1..F3
+ *  3: A0..BF     7: E1..EC, EE..EF         11: F4
+ */
+#define UTF8__CLASSES 14
+
+static const uint8_t utf8__class[0x100] = {
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+     2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+     3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+     3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+     4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+     5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+     6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 7,
+     9,10,10,10,11,12,12,12,13,13,13,13,13,13,13,13,
+};
+
+// Note: bits of the first byte that go into the codepoint (everything, for the bad bytes)
+static const uint8_t utf8__lead_mask[UTF8__CLASSES] = {
+    0x7F, 0xFF, 0xFF, 0xFF, 0x1F, 0x1F, 0x0F, 0x0F, 0x0F, 0x07, 0x07, 0x07, 0x07, 0xFF,
+};
+
+/* Note: states, named by what they still expect
+ * - `C<n>`: n continuation bytes
+ * - `E0`, `ED`, `F0`, `F4`: a continuation byte whose range depends on the first byte
+ * - `OL<n>`, `SU<n>`, `LG<n>`: n continuation bytes of an overlong,
+ *   a surrogate or a too large character
+ * Values from `UTF8__STATES` onwards are not states,
+ * they are the problems (`Utf8Status`) shifted by `UTF8__R`.
+ */
+enum {
+    UTF8__ACCEPT = 0,
+    UTF8__C1, UTF8__C2, UTF8__C3,
+    UTF8__E0, UTF8__ED, UTF8__F0, UTF8__F4,
+    UTF8__OL1, UTF8__OL2, UTF8__SU1, UTF8__LG1, UTF8__LG2, UTF8__LG3,
+    UTF8__STATES,
+};
+
+#define UTF8__R (UTF8__STATES - UTF8_OVERLONG)
+#define UTF8__OVL (UTF8__R + UTF8_OVERLONG)
+#define UTF8__SUR (UTF8__R + UTF8_SURROGATE)
+#define UTF8__BIG (UTF8__R + UTF8_TOO_LARGE)
+#define UTF8__UNX (UTF8__R + UTF8_UNEXPECTED_CONT)
+#define UTF8__INV (UTF8__R + UTF8_INVALID_BYTE)
+#define UTF8__TRN (UTF8__R + UTF8_TRUNCATED)
+
+// Note: for a state expecting a continuation byte, all the other classes truncate
+#define UTF8__CONT(c1, c2, c3) \
+    { UTF8__TRN, c1, c2, c3, UTF8__TRN, UTF8__TRN, UTF8__TRN, \
+      UTF8__TRN, UTF8__TRN, UTF8__TRN, UTF8__TRN, UTF8__TRN, UTF8__TRN, UTF8__TRN }
+
+static const uint8_t utf8__trans[UTF8__STATES][UTF8__CLASSES] = {
+    [UTF8__ACCEPT] = {
+        UTF8__ACCEPT, UTF8__UNX, UTF8__UNX, UTF8__UNX, UTF8__OL1, UTF8__C1, UTF8__E0,
+        UTF8__C2, UTF8__ED, UTF8__F0, UTF8__C3, UTF8__F4, UTF8__LG3, UTF8__INV,
+    },
+    [UTF8__C1] = UTF8__CONT(UTF8__ACCEPT, UTF8__ACCEPT, UTF8__ACCEPT),
+    [UTF8__C2] = UTF8__CONT(UTF8__C1, UTF8__C1, UTF8__C1),
+    [UTF8__C3] = UTF8__CONT(UTF8__C2, UTF8__C2, UTF8__C2),
+    [UTF8__E0] = UTF8__CONT(UTF8__OL1, UTF8__OL1, UTF8__C1),
+    [UTF8__ED] = UTF8__CONT(UTF8__C1, UTF8__C1, UTF8__SU1),
+    [UTF8__F0] = UTF8__CONT(UTF8__OL2, UTF8__C2, UTF8__C2),
+    [UTF8__F4] = UTF8__CONT(UTF8__C2, UTF8__LG2, UTF8__LG2),
+    [UTF8__OL1] = UTF8__CONT(UTF8__OVL, UTF8__OVL, UTF8__OVL),
+    [UTF8__OL2] = UTF8__CONT(UTF8__OL1, UTF8__OL1, UTF8__OL1),
+    [UTF8__SU1] = UTF8__CONT(UTF8__SUR, UTF8__SUR, UTF8__SUR),
+    [UTF8__LG1] = UTF8__CONT(UTF8__BIG, UTF8__BIG, UTF8__BIG),
+    [UTF8__LG2] = UTF8__CONT(UTF8__LG1, UTF8__LG1, UTF8__LG1),
+    [UTF8__LG3] = UTF8__CONT(UTF8__LG2, UTF8__LG2, UTF8__LG2),
+};
+
+#undef UTF8__CONT
+
+#ifdef UTF8__BLOCK
+
+/* Note: the lookup algorithm (Keiser and Lemire), errors of a byte
+ * and the one before it, found by and-ing the lookups of the high
+ * and low nibbles of the byte before and the high nibble of the byte.
+ * The missing continuations of 3 and 4 bytes characters are found
+ * apart (`UTF8__TWO_CONTS` is expected there), and so is a block
+ * ending in the middle of a character (`utf8__incomplete`).
+ */
+#define UTF8__TOO_SHORT (1 << 0)  // a lead byte not followed by a continuation
+#define UTF8__TOO_LONG (1 << 1)   // ascii followed by a continuation
+#define UTF8__OVERLONG_3 (1 << 2) // E0 80..9F
+#define UTF8__TOO_LARGE (1 << 3)  // F4 90..BF, F5..FF
+#define UTF8__SURROGATE (1 << 4)  // ED A0..BF
+#define UTF8__OVERLONG_2 (1 << 5) // C0..C1
+#define UTF8__OVERLONG_4 (1 << 6) // F0 80..8F (or F5..FF 80..8F)
+#define UTF8__TWO_CONTS (1 << 7)  // a continuation followed by a continuation
+#define UTF8__CARRY (UTF8__TOO_SHORT | UTF8__TOO_LONG | UTF8__TWO_CONTS)
+
+static const uint8_t utf8__byte_1_high[16] = {
+    UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG,
+    UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG, UTF8__TOO_LONG,
+    UTF8__TWO_CONTS, UTF8__TWO_CONTS, UTF8__TWO_CONTS, UTF8__TWO_CONTS,
+    UTF8__TOO_SHORT | UTF8__OVERLONG_2,
+    UTF8__TOO_SHORT,
+    UTF8__TOO_SHORT | UTF8__OVERLONG_3 | UTF8__SURROGATE,
+    UTF8__TOO_SHORT | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+};
+
+static const uint8_t utf8__byte_1_low[16] = {
+    UTF8__CARRY | UTF8__OVERLONG_3 | UTF8__OVERLONG_2 | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__OVERLONG_2,
+    UTF8__CARRY,
+    UTF8__CARRY,
+    UTF8__CARRY | UTF8__TOO_LARGE,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4 | UTF8__SURROGATE,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+    UTF8__CARRY | UTF8__TOO_LARGE | UTF8__OVERLONG_4,
+};
+
+static const uint8_t utf8__byte_2_high[16] = {
+    UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT,
+    UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT,
+    UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__OVERLONG_3 | UTF8__OVERLONG_4,
+    UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__OVERLONG_3 | UTF8__TOO_LARGE,
+    UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__SURROGATE | UTF8__TOO_LARGE,
+    UTF8__TOO_LONG | UTF8__OVERLONG_2 | UTF8__TWO_CONTS | UTF8__SURROGATE | UTF8__TOO_LARGE,
+    UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT, UTF8__TOO_SHORT,
+};
+
+// Note: the bytes above these ones start a character that does not fit in the block
+static const uint8_t utf8__incomplete[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+};
+
+#undef UTF8__TOO_SHORT
+#undef UTF8__TOO_LONG
+#undef UTF8__OVERLONG_3
+#undef UTF8__TOO_LARGE
+#undef UTF8__SURROGATE
+#undef UTF8__OVERLONG_2
+#undef UTF8__OVERLONG_4
+#undef UTF8__TWO_CONTS
+#undef UTF8__CARRY
+
+// Note: start of the character cut by the end of a valid `data[0..i)`
+static inline
+uint64_t utf8__boundary(const uint8_t data[], uint64_t i) {
+    if (i >= 1 && data[i - 1] >= 0xC0) {
+        return i - 1;
+    }
+    if (i >= 2 && data[i - 2] >= 0xE0) {
+        return i - 2;
+    }
+    if (i >= 3 && data[i - 3] >= 0xF0) {
+        return i - 3;
+    }
+    return i;
+}
+
+/* Note: length of the valid characters at the start of `data`
+ * (which starts a character), stopping before the block of an error
+ * and before the last `UTF8__BLOCK` bytes at most
+ */
+static
+uint64_t utf8__valid_len(const uint8_t data[], uint64_t size) {
+    uint64_t i = 0;
+#ifdef __AVX2__
+#define UTF8__LOOKUP(table) _mm256_broadcastsi128_si256( \
+        _mm_loadu_si128((const __m128i *) (const void *) (table)))
+    const __m256i byte_1_high = UTF8__LOOKUP(utf8__byte_1_high);
+    const __m256i byte_1_low = UTF8__LOOKUP(utf8__byte_1_low);
+    const __m256i byte_2_high = UTF8__LOOKUP(utf8__byte_2_high);
+#undef UTF8__LOOKUP
+    const __m256i incomplete = _mm256_loadu_si256((const __m256i *) (const void *) utf8__incomplete);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i third = _mm256_set1_epi8(0xE0 - 0x80);
+    const __m256i fourth = _mm256_set1_epi8(0xF0 - 0x80);
+    const __m256i high = _mm256_set1_epi8(-0x80);
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+
+    for (; size - i >= 32; i += 32) {
+        const __m256i input = _mm256_loadu_si256((const __m256i *) (const void *) (data + i));
+        __m256i error = prev_incomplete;
+        if (_mm256_movemask_epi8(input) != 0) {
+            // Note: `prev<n>` is the input shifted by n bytes, with the end of the previous block
+            const __m256i prev = _mm256_permute2x128_si256(prev_input, input, 0x21);
+            const __m256i prev1 = _mm256_alignr_epi8(input, prev, 16 - 1);
+            const __m256i prev2 = _mm256_alignr_epi8(input, prev, 16 - 2);
+            const __m256i prev3 = _mm256_alignr_epi8(input, prev, 16 - 3);
+            const __m256i special = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+            const __m256i must_continue = _mm256_and_si256(high, _mm256_or_si256(
+                _mm256_subs_epu8(prev2, third), _mm256_subs_epu8(prev3, fourth)));
+            error = _mm256_xor_si256(must_continue, special);
+        }
+        if (!_mm256_testz_si256(error, error)) {
+            return utf8__boundary(data, i);
+        }
+        prev_incomplete = _mm256_subs_epu8(input, incomplete);
+        prev_input = input;
+    }
+#else
+    const __m128i byte_1_high = _mm_loadu_si128((const __m128i *) (const void *) utf8__byte_1_high);
+    const __m128i byte_1_low = _mm_loadu_si128((const __m128i *) (const void *) utf8__byte_1_low);
+    const __m128i byte_2_high = _mm_loadu_si128((const __m128i *) (const void *) utf8__byte_2_high);
+    const __m128i incomplete = _mm_loadu_si128((const __m128i *) (const void *) (utf8__incomplete + 16));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i third = _mm_set1_epi8(0xE0 - 0x80);
+    const __m128i fourth = _mm_set1_epi8(0xF0 - 0x80);
+    const __m128i high = _mm_set1_epi8(-0x80);
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+
+    for (; size - i >= 16; i += 16) {
+        const __m128i input = _mm_loadu_si128((const __m128i *) (const void *) (data + i));
+        __m128i error = prev_incomplete;
+        if (_mm_movemask_epi8(input) != 0) {
+            const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 16 - 1);
+            const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 16 - 2);
+            const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 16 - 3);
+            const __m128i special = _mm_and_si128(_mm_and_si128(
+                _mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+            const __m128i must_continue = _mm_and_si128(high, _mm_or_si128(
+                _mm_subs_epu8(prev2, third), _mm_subs_epu8(prev3, fourth)));
+            error = _mm_xor_si128(must_continue, special);
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) {
+            return utf8__boundary(data, i);
+        }
+        prev_incomplete = _mm_subs_epu8(input, incomplete);
+        prev_input = input;
+    }
+#endif
+    return utf8__boundary(data, i);
+}
+
+#endif /* UTF8__BLOCK */
+
+void utf8_init(Utf8State *s) {
+    s->codepoint = 0;
+    s->state = UTF8__ACCEPT;
+    s->len = 0;
+}
+
+Utf8Status utf8_decode_byte(Utf8State *s, uint8_t c) {
+    const uint8_t cls = utf8__class[c];
+    const uint8_t next = utf8__trans[s->state][cls];
+
+    if (next == UTF8__TRN) {
+        s->state = UTF8__ACCEPT;
+        return UTF8_TRUNCATED;
+    }
+    if (s->state == UTF8__ACCEPT) {
+        s->codepoint = c & utf8__lead_mask[cls];
+        s->len = 1;
+    } else {
+        s->codepoint = (s->codepoint << 6) | (c & 0x3F);
+        s->len += 1;
+    }
+    if (next < UTF8__STATES) {
+        s->state = next;
+        return (next == UTF8__ACCEPT) ? UTF8_OK : UTF8_MORE;
+    }
+    s->state = UTF8__ACCEPT;
+    return (Utf8Status) (next - UTF8__R);
+}
+
+Utf8Status utf8_finish(Utf8State *s) {
+    const uint8_t state = s->state;
+    s->state = UTF8__ACCEPT;
+    return (state == UTF8__ACCEPT) ? UTF8_OK : UTF8_TRUNCATED;
+}
+
+uint64_t utf8_ascii_len(const uint8_t data[], uint64_t size) {
+    uint64_t i = 0;
+#ifdef __AVX2__
+    for (; size - i >= 32; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) (const void *) (data + i));
+        const unsigned int mask = (unsigned int) _mm256_movemask_epi8(v);
+        if (mask != 0) {
+            return i + (uint64_t) __builtin_ctz(mask);
+        }
+    }
+#endif
+#ifdef __SSE2__
+    for (; size - i >= 16; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (const void *) (data + i));
+        const unsigned int mask = (unsigned int) _mm_movemask_epi8(v);
+        if (mask != 0) {
+            return i + (uint64_t) __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i < size; i += 1) {
+        if (data[i] >= 0x80) {
+            break;
+        }
+    }
+    return i;
+}
+
+uint64_t utf8_validate(Utf8State *s, const uint8_t data[], uint64_t size, Utf8Status *status) {
+    Utf8Status st = (s->state == UTF8__ACCEPT) ? UTF8_OK : UTF8_MORE;
+    uint64_t i = 0;
+#ifdef UTF8__BLOCK
+    // Note: the blocks before `lookup_from` are left to the DFA (after a failing one)
+    uint64_t lookup_from = 0;
+#endif
+
+    while (i < size) {
+        if (s->state == UTF8__ACCEPT) {
+#ifdef UTF8__BLOCK
+            if (i >= lookup_from) {
+                const uint64_t n = utf8__valid_len(data + i, size - i);
+                lookup_from = i + n + UTF8__BLOCK + UTF8_MAX_LEN;
+                if (n > 0) {
+                    // Note: the last character is decoded again, for `codepoint` and `len`
+                    i += n - 1;
+                    while ((data[i] & 0xC0) == 0x80) {
+                        i -= 1;
+                    }
+                }
+            }
+#endif
+            const uint64_t n = utf8_ascii_len(data + i, size - i);
+            if (n > 0) {
+                i += n;
+                s->codepoint = data[i - 1];
+                s->len = 1;
+                st = UTF8_OK;
+                if (i == size) {
+                    break;
+                }
+            }
+        }
+        st = utf8_decode_byte(s, data[i]);
+        if (st == UTF8_TRUNCATED) {
+            break;
+        }
+        i += 1;
+        if (UTF8_IS_PROBLEM(st)) {
+            break;
+        }
+    }
+    *status = st;
+    return i;
+}
+
+uint64_t utf8_decode(Utf8State *s, const uint8_t data[], uint64_t size,
+    uint32_t out[], uint64_t *count, Utf8Status *status) {
+    Utf8Status st = (s->state == UTF8__ACCEPT) ? UTF8_OK : UTF8_MORE;
+    uint64_t k = *count;
+    uint64_t i = 0;
+
+    while (i < size) {
+        if (s->state == UTF8__ACCEPT) {
+            const uint64_t n = utf8_ascii_len(data + i, size - i);
+            if (n > 0) {
+                for (uint64_t j = 0; j < n; j += 1) {
+                    out[k + j] = data[i + j];
+                }
+                k += n;
+                i += n;
+                s->codepoint = data[i - 1];
+                s->len = 1;
+                st = UTF8_OK;
+                if (i == size) {
+                    break;
+                }
+            }
+        }
+        st = utf8_decode_byte(s, data[i]);
+        if (st == UTF8_TRUNCATED) {
+            break;
+        }
+        i += 1;
+        if (st == UTF8_OK) {
+            out[k] = s->codepoint;
+            k += 1;
+        } else if (UTF8_IS_PROBLEM(st)) {
+            break;
+        }
+    }
+    *count = k;
+    *status = st;
+    return i;
+}
+
+#undef UTF8__CLASSES
+#undef UTF8__R
+#undef UTF8__OVL
+#undef UTF8__SUR
+#undef UTF8__BIG
+#undef UTF8__UNX
+#undef UTF8__INV
+#undef UTF8__TRN
+#undef UTF8__BLOCK
+
+#endif /* _HASHI_UTF8_IMPL_ */
+#endif /* HASHI_UTF8_IMPLEMENTATION */
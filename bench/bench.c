@@ -0,0 +1,887 @@
+/* bench (benchmarks)
+ *
+ * Times the hot kernels of the tools, over generated inputs:
+ * - `sha1_hash`, and `sha1_update` fed in pieces of 1000 bytes,
+ *   from 1 B up to 1 GiB (or the size of flag `-m`, as in `-m 16M`),
+ *   and `sha1dc_update` (collision detection) at 16 MiB,
+ *   reporting its overhead over `sha1_hash` at the same size;
+ * - aucompress `compress` and `decompress` from 256 B to 64 KiB
+ *   (over memory, see `cutils_io.h`);
+ * - becho's decoder (`utf8_validate` and `utf8_decode`, see `utf8.h`).
+ * Each case is warmed up (50 ms), then sampled (each sample takes about 2 ms)
+ * and reports the median and p99 of the samples,
+ * with the throughput and cycles (`rdtsc`) per byte.
+ * Use flag `-j` for a JSON report.
+ * Before the timings, checks sha1 against the FIPS 180 test vectors,
+ * sha1dc against the SHAttered collision (and its condition table
+ * against its disturbance vectors), HMAC-SHA1 and PBKDF2-HMAC-SHA1
+ * against the RFC 2202 and RFC 6070 ones
+ * and the codecs against their inputs, exiting with 1 on a mismatch.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+/* Note: aucompress and `cutils_io.h` are POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+#define HASHI_SHA1_IMPLEMENTATION
+#include "../sha1/sha1.h"
+
+#define HASHI_UTF8_IMPLEMENTATION
+#include "../becho/utf8.h"
+
+#define HASHI_AUCOMPRESS_NO_MAIN
+#include "../aucompress/aucompress.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES 1
+#else
+#define BENCH_CYCLES 0
+#endif
+
+#define BENCH_MAX_SIZE (1ULL << 30)
+#define BENCH_SIZE_STEP 4
+#define BENCH_PIECE_LEN 1000
+#define BENCH_DC_LEN (16 << 20)
+#define BENCH_UTF8_LEN (16 << 20)
+#define BENCH_AU_MIN_LEN 0x100
+#define BENCH_AU_LEN 0x10000
+
+/* Note: a case is first repeated for at least `BENCH_WARMUP_NS`,
+ * then each sample repeats it for at least `BENCH_SAMPLE_NS`,
+ * and all samples take about `BENCH_CASE_NS` (keeping the sample count in bounds)
+ */
+#define BENCH_WARMUP_NS 5e7
+#define BENCH_SAMPLE_NS 2e6
+#define BENCH_CASE_NS 4e8
+#define BENCH_MIN_SAMPLES 5
+#define BENCH_MAX_SAMPLES 201
+#define BENCH_MAX_RESULTS 64
+#define BENCH_NAME_LEN 0x20
+
+typedef struct {
+    char name[BENCH_NAME_LEN];
+    uint64_t size;
+    uint64_t calls;
+    uint32_t samples;
+    double median; // ns per call
+    double p99;    // ns per call
+    double cycles; // per byte, of the median sample
+} Result;
+
+static struct {
+    Result items[BENCH_MAX_RESULTS];
+    size_t len;
+} results;
+
+// Note: the data of every case, the kernels only read it
+static uint8_t *data;
+static uint64_t data_len;
+static uint32_t *codepoints;
+static uint8_t *au_text;
+static uint8_t *au_packed;
+static size_t au_packed_len;
+static CioWriter au_out;
+static volatile uint8_t sink;
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+uint64_t ticks(void) {
+#if BENCH_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Note: xorshift64, `rand` is too slow for 1 GiB
+uint64_t next_random(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+int cmp_double(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+int cmp_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Kernels */
+
+void run_sha1_hash(uint64_t size) {
+    uint8_t out[SHA1_DIGEST_LEN];
+    sha1_hash(data, size, out);
+    sink = out[0];
+}
+
+void run_sha1_update(uint64_t size) {
+    Sha1State s;
+    uint8_t out[SHA1_DIGEST_LEN];
+    sha1_init(&s);
+    for (uint64_t i = 0; i < size; i += BENCH_PIECE_LEN) {
+        sha1_update(&s, data + i, size - i < BENCH_PIECE_LEN ? size - i : BENCH_PIECE_LEN);
+    }
+    sha1_finish(&s, out);
+    sink = out[0];
+}
+
+void run_sha1dc_update(uint64_t size) {
+    Sha1DcState s;
+    uint8_t out[SHA1_DIGEST_LEN];
+    sha1dc_init(&s);
+    sha1dc_update(&s, data, size);
+    sink = sha1dc_finish(&s, out) | out[0];
+}
+
+void run_utf8_validate(uint64_t size) {
+    Utf8State s;
+    Utf8Status status;
+    utf8_init(&s);
+    sink = (uint8_t) utf8_validate(&s, data, size, &status);
+}
+
+void run_utf8_decode(uint64_t size) {
+    Utf8State s;
+    Utf8Status status;
+    uint64_t count = 0;
+    utf8_init(&s);
+    utf8_decode(&s, data, size, codepoints, &count, &status);
+    sink = (uint8_t) count;
+}
+
+// Note: the compressor keeps its table in globals
+void au_reset(void) {
+    memset(symbol_table, 0, (size_t) symbol_table_meta_size * 0x100 * sizeof(symbol_table[0]));
+    symbol_table_meta_size = 1;
+    symbol_table_last_size = 1;
+    globals = (struct GlobalState){
+        .output_mode = OUTPUT_BITS,
+        .outbuf = 0,
+        .outbuf_size = 0,
+    };
+}
+
+void run_compress(uint64_t size) {
+    CioReader in;
+    au_reset();
+    cio_reader_mem(&in, au_text, size);
+    compress(&in, &au_out);
+    cio_flush(&au_out);
+}
+
+// Note: `size` is the one of the decompressed text
+void run_decompress(uint64_t size) {
+    CioReader in;
+    (void) size;
+    au_reset();
+    cio_reader_mem(&in, au_packed, au_packed_len);
+    decompress(&in, &au_out);
+    cio_flush(&au_out);
+}
+
+/* Measurement */
+
+void bench(const char *name, void (*run)(uint64_t), uint64_t size) {
+    static double times[BENCH_MAX_SAMPLES];
+    static uint64_t cycles[BENCH_MAX_SAMPLES];
+    Result *r = &results.items[results.len];
+    double first;
+    uint64_t warmup_calls = 0;
+    uint64_t calls;
+    uint32_t samples;
+
+    if ( results.len == BENCH_MAX_RESULTS ) {
+        fprintf(stderr, "Too many results, skipping %s\n", name);
+        return;
+    }
+    results.len += 1;
+
+    /* Note: the warmup (caches, branch predictors and the cpu clock)
+     * also calibrates the number of calls per sample
+     */
+    first = now();
+    do {
+        run(size);
+        warmup_calls += 1;
+    } while (now() - first < BENCH_WARMUP_NS);
+    first = (now() - first) / (double) warmup_calls;
+    if ( first < 1.0 ) {
+        first = 1.0;
+    }
+    calls = first < BENCH_SAMPLE_NS ? (uint64_t) (BENCH_SAMPLE_NS / first) : 1;
+    samples = (uint32_t) (BENCH_CASE_NS / (first * (double) calls));
+    samples = samples < BENCH_MIN_SAMPLES ? BENCH_MIN_SAMPLES : samples;
+    samples = samples > BENCH_MAX_SAMPLES ? BENCH_MAX_SAMPLES : samples;
+
+    for (uint32_t i = 0; i < samples; i += 1) {
+        const double start = now();
+        const uint64_t start_cycles = ticks();
+        for (uint64_t c = 0; c < calls; c += 1) {
+            run(size);
+        }
+        cycles[i] = ticks() - start_cycles;
+        times[i] = (now() - start) / (double) calls;
+    }
+
+    qsort(times, samples, sizeof(times[0]), cmp_double);
+    qsort(cycles, samples, sizeof(cycles[0]), cmp_u64);
+    snprintf(r->name, BENCH_NAME_LEN, "%s", name);
+    r->size = size;
+    r->calls = calls;
+    r->samples = samples;
+    r->median = times[samples / 2];
+    // Note: the sample at the 99th percentile (rounding up), the maximum for less than 100 samples
+    r->p99 = times[(99 * samples + 99) / 100 - 1];
+    r->cycles = size == 0 ? 0.0 : (double) cycles[samples / 2] / ((double) calls * (double) size);
+}
+
+/* Checks */
+
+// Note: `len` bytes of `out` (at most `CHECK_MAX_LEN`) against their hex
+#define CHECK_MAX_LEN 0x20
+uint8_t check_hex(const char *name, const uint8_t out[], uint8_t len, const char *hex) {
+    char got[2 * CHECK_MAX_LEN + 1];
+    for (uint8_t i = 0; i < len; i += 1) {
+        snprintf(got + 2 * i, 3, "%02x", out[i]);
+    }
+    if ( strcmp(got, hex) != 0 ) {
+        fprintf(stderr, "%s: expected %s, got %s\n", name, hex, got);
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t check_digest(const char *name, const uint8_t out[SHA1_DIGEST_LEN], const char *hex) {
+    return check_hex(name, out, SHA1_DIGEST_LEN, hex);
+}
+
+// Note: FIPS 180-2, appendix A, and the empty message
+uint8_t check_sha1(void) {
+    static const struct {
+        const char *msg;
+        uint32_t repeat;
+        const char *hex;
+    } vectors[] = {
+        { "", 1, "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+        { "abc", 1, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+            "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+        { "a", 1000000, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+    };
+    uint8_t failed = 0;
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v += 1) {
+        const size_t len = strlen(vectors[v].msg);
+        const uint64_t size = (uint64_t) len * vectors[v].repeat;
+        uint8_t *msg = malloc(size + 1);
+        uint8_t out[SHA1_DIGEST_LEN];
+        Sha1State s;
+        Sha1DcState dc;
+
+        for (uint32_t i = 0; i < vectors[v].repeat; i += 1) {
+            memcpy(msg + (size_t) i * len, vectors[v].msg, len);
+        }
+
+        sha1_hash(msg, size, out);
+        failed |= check_digest("sha1_hash", out, vectors[v].hex);
+
+        // Note: odd pieces, crossing the chunk boundaries
+        sha1_init(&s);
+        for (uint64_t i = 0; i < size; i += 7) {
+            sha1_update(&s, msg + i, size - i < 7 ? size - i : 7);
+        }
+        sha1_finish(&s, out);
+        failed |= check_digest("sha1_update", out, vectors[v].hex);
+
+        sha1dc_init(&dc);
+        sha1dc_update(&dc, msg, size);
+        if ( sha1dc_finish(&dc, out) ) {
+            fprintf(stderr, "sha1dc: false collision on a test vector\n");
+            failed = 1;
+        }
+        failed |= check_digest("sha1dc_update", out, vectors[v].hex);
+        free(msg);
+    }
+    return failed;
+}
+
+/* Note: RFC 2202 (HMAC-SHA1), section 3, a NULL key or data
+ * is `len` bytes of `fill`
+ */
+uint8_t check_sha1_hmac(void) {
+    static const struct {
+        const char *key;
+        uint8_t key_fill;
+        uint8_t key_len;
+        const char *data;
+        uint8_t data_fill;
+        uint8_t data_len;
+        const char *hex;
+    } vectors[] = {
+        { NULL, 0x0b, 20, "Hi There", 0, 8, "b617318655057264e28bc0b6fb378c8ef146be00" },
+        { "Jefe", 0, 4, "what do ya want for nothing?", 0, 28, "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79" },
+        { NULL, 0xaa, 20, NULL, 0xdd, 50, "125d7342b9ac11cd91a39af48aa17b4f63f175d3" },
+        { "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19", 0, 25,
+            NULL, 0xcd, 50, "4c9007f4026250c6bc8414f9bf50c86c2d7235da" },
+        { NULL, 0x0c, 20, "Test With Truncation", 0, 20, "4c1a03424b55e07fe7f27be1d58bb9324a9a5a04" },
+        { NULL, 0xaa, 80, "Test Using Larger Than Block-Size Key - Hash Key First", 0, 54,
+            "aa4ae5e15272d00e95705637ce8a3b55ed402112" },
+        { NULL, 0xaa, 80, "Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data", 0, 73,
+            "e8e99d0f45237d786d6bbaa7965c7808bbff1a91" },
+    };
+    uint8_t failed = 0;
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v += 1) {
+        uint8_t key[0x100];
+        uint8_t msg[0x100];
+        uint8_t out[SHA1_DIGEST_LEN];
+        Sha1HmacKey k;
+
+        if ( vectors[v].key ) {
+            memcpy(key, vectors[v].key, vectors[v].key_len);
+        } else {
+            memset(key, vectors[v].key_fill, vectors[v].key_len);
+        }
+        if ( vectors[v].data ) {
+            memcpy(msg, vectors[v].data, vectors[v].data_len);
+        } else {
+            memset(msg, vectors[v].data_fill, vectors[v].data_len);
+        }
+        sha1_hmac_key(&k, key, vectors[v].key_len);
+        sha1_hmac(&k, msg, vectors[v].data_len, out);
+        failed |= check_digest("sha1_hmac", out, vectors[v].hex);
+    }
+    return failed;
+}
+
+// Note: RFC 6070 (PBKDF2-HMAC-SHA1), but for the one of 16777216 iterations
+uint8_t check_sha1_pbkdf2(void) {
+    static const struct {
+        const char *password;
+        uint8_t password_len;
+        const char *salt;
+        uint8_t salt_len;
+        uint32_t iterations;
+        uint8_t len;
+        const char *hex;
+    } vectors[] = {
+        { "password", 8, "salt", 4, 1, 20, "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+        { "password", 8, "salt", 4, 2, 20, "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+        { "password", 8, "salt", 4, 4096, 20, "4b007901b765489abead49d926f721d065a429c1" },
+        { "passwordPASSWORDpassword", 24, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, 25,
+            "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+        { "pass\0word", 9, "sa\0lt", 5, 4096, 16, "56fa6aa75548099dcc37d7f03425e0c3" },
+    };
+    uint8_t out[CHECK_MAX_LEN];
+    uint8_t failed = 0;
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v += 1) {
+        if ( sha1_pbkdf2(
+                (const uint8_t *) vectors[v].password, vectors[v].password_len,
+                (const uint8_t *) vectors[v].salt, vectors[v].salt_len,
+                vectors[v].iterations, out, vectors[v].len) ) {
+            fprintf(stderr, "sha1_pbkdf2: rejected a test vector\n");
+            failed = 1;
+        }
+        failed |= check_hex("sha1_pbkdf2", out, vectors[v].len, vectors[v].hex);
+    }
+    // Note: "derived key too long", nothing is written
+    if ( !sha1_pbkdf2((const uint8_t *) "p", 1, (const uint8_t *) "s", 1, 1, out, SHA1_PBKDF2_MAX_LEN + 1) ) {
+        fprintf(stderr, "sha1_pbkdf2: took a derived key longer than (2^32 - 1) * 20 bytes\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+/* Note: the first 320 bytes of shattered-1.pdf and shattered-2.pdf (shattered.io),
+ * a common header of 3 chunks, then the 2 chunks that collide
+ */
+static const uint8_t shattered_head[192] = {
+    0x25, 0x50, 0x44, 0x46, 0x2d, 0x31, 0x2e, 0x33, 0x0a, 0x25, 0xe2, 0xe3,
+    0xcf, 0xd3, 0x0a, 0x0a, 0x0a, 0x31, 0x20, 0x30, 0x20, 0x6f, 0x62, 0x6a,
+    0x0a, 0x3c, 0x3c, 0x2f, 0x57, 0x69, 0x64, 0x74, 0x68, 0x20, 0x32, 0x20,
+    0x30, 0x20, 0x52, 0x2f, 0x48, 0x65, 0x69, 0x67, 0x68, 0x74, 0x20, 0x33,
+    0x20, 0x30, 0x20, 0x52, 0x2f, 0x54, 0x79, 0x70, 0x65, 0x20, 0x34, 0x20,
+    0x30, 0x20, 0x52, 0x2f, 0x53, 0x75, 0x62, 0x74, 0x79, 0x70, 0x65, 0x20,
+    0x35, 0x20, 0x30, 0x20, 0x52, 0x2f, 0x46, 0x69, 0x6c, 0x74, 0x65, 0x72,
+    0x20, 0x36, 0x20, 0x30, 0x20, 0x52, 0x2f, 0x43, 0x6f, 0x6c, 0x6f, 0x72,
+    0x53, 0x70, 0x61, 0x63, 0x65, 0x20, 0x37, 0x20, 0x30, 0x20, 0x52, 0x2f,
+    0x4c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x20, 0x38, 0x20, 0x30, 0x20, 0x52,
+    0x2f, 0x42, 0x69, 0x74, 0x73, 0x50, 0x65, 0x72, 0x43, 0x6f, 0x6d, 0x70,
+    0x6f, 0x6e, 0x65, 0x6e, 0x74, 0x20, 0x38, 0x3e, 0x3e, 0x0a, 0x73, 0x74,
+    0x72, 0x65, 0x61, 0x6d, 0x0a, 0xff, 0xd8, 0xff, 0xfe, 0x00, 0x24, 0x53,
+    0x48, 0x41, 0x2d, 0x31, 0x20, 0x69, 0x73, 0x20, 0x64, 0x65, 0x61, 0x64,
+    0x21, 0x21, 0x21, 0x21, 0x21, 0x85, 0x2f, 0xec, 0x09, 0x23, 0x39, 0x75,
+    0x9c, 0x39, 0xb1, 0xa1, 0xc6, 0x3c, 0x4c, 0x97, 0xe1, 0xff, 0xfe, 0x01,
+};
+static const uint8_t shattered_blocks[2][128] = {
+    {
+        0x7f, 0x46, 0xdc, 0x93, 0xa6, 0xb6, 0x7e, 0x01, 0x3b, 0x02, 0x9a, 0xaa,
+        0x1d, 0xb2, 0x56, 0x0b, 0x45, 0xca, 0x67, 0xd6, 0x88, 0xc7, 0xf8, 0x4b,
+        0x8c, 0x4c, 0x79, 0x1f, 0xe0, 0x2b, 0x3d, 0xf6, 0x14, 0xf8, 0x6d, 0xb1,
+        0x69, 0x09, 0x01, 0xc5, 0x6b, 0x45, 0xc1, 0x53, 0x0a, 0xfe, 0xdf, 0xb7,
+        0x60, 0x38, 0xe9, 0x72, 0x72, 0x2f, 0xe7, 0xad, 0x72, 0x8f, 0x0e, 0x49,
+        0x04, 0xe0, 0x46, 0xc2, 0x30, 0x57, 0x0f, 0xe9, 0xd4, 0x13, 0x98, 0xab,
+        0xe1, 0x2e, 0xf5, 0xbc, 0x94, 0x2b, 0xe3, 0x35, 0x42, 0xa4, 0x80, 0x2d,
+        0x98, 0xb5, 0xd7, 0x0f, 0x2a, 0x33, 0x2e, 0xc3, 0x7f, 0xac, 0x35, 0x14,
+        0xe7, 0x4d, 0xdc, 0x0f, 0x2c, 0xc1, 0xa8, 0x74, 0xcd, 0x0c, 0x78, 0x30,
+        0x5a, 0x21, 0x56, 0x64, 0x61, 0x30, 0x97, 0x89, 0x60, 0x6b, 0xd0, 0xbf,
+        0x3f, 0x98, 0xcd, 0xa8, 0x04, 0x46, 0x29, 0xa1,
+    },
+    {
+        0x73, 0x46, 0xdc, 0x91, 0x66, 0xb6, 0x7e, 0x11, 0x8f, 0x02, 0x9a, 0xb6,
+        0x21, 0xb2, 0x56, 0x0f, 0xf9, 0xca, 0x67, 0xcc, 0xa8, 0xc7, 0xf8, 0x5b,
+        0xa8, 0x4c, 0x79, 0x03, 0x0c, 0x2b, 0x3d, 0xe2, 0x18, 0xf8, 0x6d, 0xb3,
+        0xa9, 0x09, 0x01, 0xd5, 0xdf, 0x45, 0xc1, 0x4f, 0x26, 0xfe, 0xdf, 0xb3,
+        0xdc, 0x38, 0xe9, 0x6a, 0xc2, 0x2f, 0xe7, 0xbd, 0x72, 0x8f, 0x0e, 0x45,
+        0xbc, 0xe0, 0x46, 0xd2, 0x3c, 0x57, 0x0f, 0xeb, 0x14, 0x13, 0x98, 0xbb,
+        0x55, 0x2e, 0xf5, 0xa0, 0xa8, 0x2b, 0xe3, 0x31, 0xfe, 0xa4, 0x80, 0x37,
+        0xb8, 0xb5, 0xd7, 0x1f, 0x0e, 0x33, 0x2e, 0xdf, 0x93, 0xac, 0x35, 0x00,
+        0xeb, 0x4d, 0xdc, 0x0d, 0xec, 0xc1, 0xa8, 0x64, 0x79, 0x0c, 0x78, 0x2c,
+        0x76, 0x21, 0x56, 0x60, 0xdd, 0x30, 0x97, 0x91, 0xd0, 0x6b, 0xd0, 0xaf,
+        0x3f, 0x98, 0xcd, 0xa4, 0xbc, 0x46, 0x29, 0xb1,
+    },
+};
+
+// Note: both prefixes have the same sha1, sha1dc flags them and gives their safe hash
+uint8_t check_sha1dc(void) {
+    static const char *safe[2] = {
+        "29f38ae9fd98e2931120fa0bf213e024250d3f6a",
+        "7117b3cb9225aaf0d8ef1a40e493957b0bf8693d",
+    };
+    uint8_t msg[sizeof(shattered_head) + sizeof(shattered_blocks[0])];
+    uint8_t out[SHA1_DIGEST_LEN];
+    uint8_t failed = 0;
+    memcpy(msg, shattered_head, sizeof(shattered_head));
+    for (uint8_t f = 0; f < 2; f += 1) {
+        memcpy(msg + sizeof(shattered_head), shattered_blocks[f], sizeof(shattered_blocks[f]));
+
+        sha1_hash(msg, sizeof(msg), out);
+        failed |= check_digest("sha1_hash", out, "f92d74e3874587aaf443d1db961d4e26dde13e9c");
+
+        if ( !sha1dc_hash(msg, sizeof(msg), out) ) {
+            fprintf(stderr, "sha1dc: SHAttered not detected\n");
+            failed = 1;
+        }
+        failed |= check_digest("sha1dc_hash", out, safe[f]);
+    }
+    return failed;
+}
+
+typedef struct {
+    uint8_t t;
+    uint8_t j;
+    uint8_t o;
+    uint32_t dvs;
+} DcCondition;
+
+static const DcCondition dc_conditions[] = {
+    #define BENCH_DC_CONDITION(t, j, o, dvs) {t, j, o, dvs},
+    SHA1DC_CONDITIONS(BENCH_DC_CONDITION)
+    #undef BENCH_DC_CONDITION
+};
+
+// Note: the expected number of DVs ruled out by a condition, with `alive[i]` for DV i
+uint64_t dc_gain(const uint64_t alive[SHA1DC_DVS_LEN], uint32_t dvs) {
+    uint64_t gain = 0;
+    for (uint8_t i = 0; i < SHA1DC_DVS_LEN; i += 1) {
+        gain += (dvs >> i) & 1 ? alive[i] : 0;
+    }
+    return gain;
+}
+
+/* Note: re-derives `SHA1DC_CONDITIONS` from the DVs (see `sha1.h`):
+ * a disturbance of steps 20-74 on bit j < 31, counted once in its DV
+ * (with the bits of the local collisions of every disturbance),
+ * and its correction at step t+1 (bit j+5) or t+5 (bit j+30),
+ * also counted once and not on bit 31, give a condition.
+ * The table must hold exactly these, ordered greedily
+ * (each DV alive with weight 2^31, halved by each condition ruling it out).
+ */
+uint8_t check_sha1dc_conditions(void) {
+    static const uint8_t rot[6] = {0, 5, 0, 30, 30, 30};
+    static uint32_t derived[2][SHA1DC_STEPS][32];
+    static uint32_t listed[2][SHA1DC_STEPS][32];
+    const size_t len = sizeof(dc_conditions) / sizeof(dc_conditions[0]);
+    uint64_t alive[SHA1DC_DVS_LEN];
+
+    for (uint8_t i = 0; i < SHA1DC_DVS_LEN; i += 1) {
+        uint32_t dv[SHA1DC_PRE + SHA1DC_STEPS];
+        uint8_t count[SHA1DC_PRE + SHA1DC_STEPS][32] = {{0}};
+        sha1dc__dv(i, dv);
+        for (uint8_t x = 0; x < SHA1DC_PRE + SHA1DC_STEPS; x += 1) {
+            for (uint8_t j = 0; j < 32; j += 1) {
+                for (uint8_t o = 0; o < 6 && x + o < SHA1DC_PRE + SHA1DC_STEPS; o += 1) {
+                    count[x + o][(j + rot[o]) & 31] += (dv[x] >> j) & 1;
+                }
+            }
+        }
+        for (uint8_t t = 20; t < 75; t += 1) {
+            const uint8_t x = t + SHA1DC_PRE;
+            for (uint8_t j = 0; j < 31; j += 1) {
+                if ( ((dv[x] >> j) & 1) == 0 || count[x][j] != 1 ) {
+                    continue;
+                }
+                if ( ((j + 5) & 31) != 31 && count[x + 1][(j + 5) & 31] == 1 ) {
+                    derived[0][t][j] |= 1U << i;
+                }
+                if ( j != 1 && count[x + 5][(j + 30) & 31] == 1 ) {
+                    derived[1][t][j] |= 1U << i;
+                }
+            }
+        }
+    }
+
+    for (size_t c = 0; c < len; c += 1) {
+        const DcCondition *d = &dc_conditions[c];
+        if ( (d->o != 1 && d->o != 5) || SHA1DC_STEPS <= d->t || 31 < d->j
+            || listed[d->o == 5][d->t][d->j] != 0 ) {
+            fprintf(stderr, "sha1dc: condition (%u, %u, %u) invalid or repeated\n", d->t, d->j, d->o);
+            return 1;
+        }
+        listed[d->o == 5][d->t][d->j] = d->dvs;
+    }
+    if ( memcmp(derived, listed, sizeof(derived)) != 0 ) {
+        fprintf(stderr, "sha1dc: SHA1DC_CONDITIONS differs from the conditions of the DVs\n");
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < SHA1DC_DVS_LEN; i += 1) {
+        alive[i] = 1ULL << 31;
+    }
+    for (size_t c = 0; c < len; c += 1) {
+        const uint64_t gain = dc_gain(alive, dc_conditions[c].dvs);
+        for (size_t n = c + 1; n < len; n += 1) {
+            if ( gain < dc_gain(alive, dc_conditions[n].dvs) ) {
+                fprintf(stderr, "sha1dc: SHA1DC_CONDITIONS not ordered greedily at %zu\n", c);
+                return 1;
+            }
+        }
+        for (uint8_t i = 0; i < SHA1DC_DVS_LEN; i += 1) {
+            alive[i] >>= (dc_conditions[c].dvs >> i) & 1;
+        }
+    }
+    return 0;
+}
+
+/* Note: the mixed text is 1/2 ascii, 1/4 two bytes, 1/8 three bytes
+ * and 1/8 four bytes characters, writing their codepoints to `expected`
+ */
+uint64_t make_mixed(uint8_t dst[], uint64_t len, uint32_t expected[], uint64_t *count) {
+    uint64_t x = 0x5A1;
+    uint64_t i = 0;
+    *count = 0;
+    while (i + UTF8_MAX_LEN <= len) {
+        const uint64_t r = next_random(&x);
+        uint32_t cp;
+        switch (r & 7) {
+            case 0: case 1: case 2: case 3: {
+                cp = 0x20 + (uint32_t) ((r >> 8) % 0x5F);
+                dst[i] = (uint8_t) cp;
+                i += 1;
+            } break;
+            case 4: case 5: {
+                cp = 0x80 + (uint32_t) ((r >> 8) % 0x780);
+                dst[i] = (uint8_t) (0xC0 | (cp >> 6));
+                dst[i + 1] = (uint8_t) (0x80 | (cp & 0x3F));
+                i += 2;
+            } break;
+            case 6: {
+                // Note: skips the surrogates
+                cp = 0x800 + (uint32_t) ((r >> 8) % 0xF000);
+                cp = cp >= 0xD800 ? cp + 0x800 : cp;
+                dst[i] = (uint8_t) (0xE0 | (cp >> 12));
+                dst[i + 1] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+                dst[i + 2] = (uint8_t) (0x80 | (cp & 0x3F));
+                i += 3;
+            } break;
+            default: {
+                cp = 0x10000 + (uint32_t) ((r >> 8) % 0x100000);
+                dst[i] = (uint8_t) (0xF0 | (cp >> 18));
+                dst[i + 1] = (uint8_t) (0x80 | ((cp >> 12) & 0x3F));
+                dst[i + 2] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+                dst[i + 3] = (uint8_t) (0x80 | (cp & 0x3F));
+                i += 4;
+            } break;
+        }
+        expected[*count] = cp;
+        *count += 1;
+    }
+    return i;
+}
+
+uint8_t check_utf8(uint64_t len, const uint32_t expected[], uint64_t expected_count) {
+    Utf8State s;
+    Utf8Status status;
+    uint64_t count = 0;
+    utf8_init(&s);
+    if ( utf8_decode(&s, data, len, codepoints, &count, &status) != len || status != UTF8_OK
+        || count != expected_count
+        || memcmp(codepoints, expected, count * sizeof(codepoints[0])) != 0 ) {
+        fprintf(stderr, "utf8_decode: the mixed text did not decode to its codepoints\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* Note: words of english (no 0 bytes, which `aucompress` does not take yet),
+ * short enough for its table (it has no reset)
+ */
+void make_text(uint8_t dst[], size_t len) {
+    static const char *words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as",
+        "with", "be", "on", "not", "this", "by", "are", "or", "from", "at",
+        "compress", "table", "symbol", "byte", "\n",
+    };
+    const size_t words_len = sizeof(words) / sizeof(words[0]);
+    uint64_t x = 0xC0DE;
+    size_t i = 0;
+    while (i < len) {
+        const char *w = words[next_random(&x) % words_len];
+        for (size_t j = 0; w[j] != '\0' && i < len; j += 1, i += 1) {
+            dst[i] = (uint8_t) w[j];
+        }
+        if ( i < len ) {
+            dst[i] = ' ';
+            i += 1;
+        }
+    }
+}
+
+// Note: compresses `size` bytes of the text into `au_packed`, checking that it decompresses back
+uint8_t pack_text(uint64_t size) {
+    CioReader in;
+    CioWriter packed;
+    CioWriter unpacked;
+    uint8_t failed;
+
+    au_reset();
+    cio_reader_mem(&in, au_text, size);
+    cio_writer_mem(&packed, 1);
+    compress(&in, &packed);
+    cio_flush(&packed);
+
+    au_reset();
+    cio_reader_mem(&in, packed.mem, packed.mem_len);
+    cio_writer_mem(&unpacked, 1);
+    decompress(&in, &unpacked);
+    cio_flush(&unpacked);
+
+    failed = unpacked.mem_len != size || memcmp(unpacked.mem, au_text, size) != 0;
+    if ( failed ) {
+        fprintf(stderr, "aucompress: %llu bytes of text did not decompress back\n", (unsigned long long) size);
+    } else {
+        free(au_packed);
+        au_packed_len = packed.mem_len;
+        au_packed = malloc(au_packed_len);
+        memcpy(au_packed, packed.mem, au_packed_len);
+    }
+    cio_writer_close(&packed);
+    cio_writer_close(&unpacked);
+    return failed;
+}
+
+/* Reports */
+
+void format_size(char dst[], size_t len, uint64_t size) {
+    static const char *units[] = { "B", "KiB", "MiB", "GiB" };
+    size_t u = 0;
+    while (u + 1 < sizeof(units) / sizeof(units[0]) && size >= 1024 && size % 1024 == 0) {
+        size /= 1024;
+        u += 1;
+    }
+    snprintf(dst, len, "%llu %s", (unsigned long long) size, units[u]);
+}
+
+// Note: the result of case `name` at `size`, or NULL when it did not run
+const Result *find_result(const char *name, uint64_t size) {
+    for (size_t i = 0; i < results.len; i += 1) {
+        if ( results.items[i].size == size && strcmp(results.items[i].name, name) == 0 ) {
+            return &results.items[i];
+        }
+    }
+    return NULL;
+}
+
+/* Note: the cost of collision detection, as the ratio of the medians
+ * of `sha1dc_update` and `sha1_hash` at `BENCH_DC_LEN`, minus 1;
+ * returns 1 when they did not run
+ */
+uint8_t dc_overhead(double *overhead) {
+    const Result *dc = find_result("sha1dc_update", BENCH_DC_LEN);
+    const Result *base = find_result("sha1_hash", BENCH_DC_LEN);
+    if ( dc == NULL || base == NULL ) {
+        return 1;
+    }
+    *overhead = dc->median / base->median - 1;
+    return 0;
+}
+
+void report_text(void) {
+    double overhead;
+    printf("%-20s %9s %8s %7s %14s %14s %10s %9s\n",
+        "case", "size", "calls", "samples", "median (ns)", "p99 (ns)", "MiB/s", "cycles/B");
+    for (size_t i = 0; i < results.len; i += 1) {
+        const Result *r = &results.items[i];
+        char size[0x10];
+        format_size(size, sizeof(size), r->size);
+        printf("%-20s %9s %8llu %7u %14.1f %14.1f %10.2f ",
+            r->name, size, (unsigned long long) r->calls, r->samples,
+            r->median, r->p99, (double) r->size / r->median * 1e9 / (1 << 20));
+        if ( BENCH_CYCLES ) {
+            printf("%9.2f\n", r->cycles);
+        } else {
+            printf("%9s\n", "-");
+        }
+    }
+    if ( dc_overhead(&overhead) == 0 ) {
+        printf("\nsha1dc_update overhead over sha1_hash: %+.1f%%\n", overhead * 100);
+    }
+}
+
+void report_json(void) {
+    double overhead;
+    printf("{\"cycles\": %s, \"results\": [", BENCH_CYCLES ? "\"rdtsc\"" : "null");
+    for (size_t i = 0; i < results.len; i += 1) {
+        const Result *r = &results.items[i];
+        printf("%s\n  {\"case\": \"%s\", \"size\": %llu, \"calls\": %llu, \"samples\": %u, "
+            "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"mib_per_s\": %.2f, \"cycles_per_byte\": ",
+            i == 0 ? "" : ",", r->name, (unsigned long long) r->size,
+            (unsigned long long) r->calls, r->samples, r->median, r->p99,
+            (double) r->size / r->median * 1e9 / (1 << 20));
+        if ( BENCH_CYCLES ) {
+            printf("%.3f}", r->cycles);
+        } else {
+            printf("null}");
+        }
+    }
+    printf("\n], \"sha1dc_overhead\": ");
+    if ( dc_overhead(&overhead) == 0 ) {
+        printf("%.3f}\n", overhead);
+    } else {
+        printf("null}\n");
+    }
+}
+
+// Note: a number of bytes, with an optional K, M or G (powers of 1024)
+uint64_t parse_size(const char *s) {
+    char *end;
+    uint64_t size = strtoull(s, &end, 10);
+    switch (*end) {
+        case 'K': size <<= 10; end += 1; break;
+        case 'M': size <<= 20; end += 1; break;
+        case 'G': size <<= 30; end += 1; break;
+        default: break;
+    }
+    return *end == '\0' ? size : 0;
+}
+
+int main(const int argc, const char *argv[]) {
+    uint64_t max_size = BENCH_MAX_SIZE;
+    uint8_t json = 0;
+    uint32_t *expected;
+    uint64_t expected_count;
+    uint64_t utf8_len;
+    uint64_t x = 0x5A1;
+
+    for (int i = 1; i < argc; i += 1) {
+        if ( strcmp(argv[i], "-j") == 0 ) {
+            json = 1;
+        } else if ( strcmp(argv[i], "-m") == 0 && i + 1 < argc && parse_size(argv[i + 1]) != 0 ) {
+            max_size = parse_size(argv[i + 1]);
+            i += 1;
+        } else {
+            fprintf(stderr, "usage: %s [-j] [-m max_size]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    data_len = max_size > BENCH_UTF8_LEN ? max_size : BENCH_UTF8_LEN;
+    data = malloc(data_len);
+    codepoints = malloc(BENCH_UTF8_LEN * sizeof(codepoints[0]));
+    expected = malloc(BENCH_UTF8_LEN * sizeof(expected[0]));
+    au_text = malloc(BENCH_AU_LEN);
+    if ( data == NULL || codepoints == NULL || expected == NULL || au_text == NULL
+        || cio_writer_mem(&au_out, 0) != 0 ) {
+        fprintf(stderr, "Could not allocate %llu bytes\n", (unsigned long long) data_len);
+        return 1;
+    }
+
+    make_text(au_text, BENCH_AU_LEN);
+    utf8_len = make_mixed(data, BENCH_UTF8_LEN, expected, &expected_count);
+    if ( check_sha1() | check_sha1dc() | check_sha1dc_conditions() | check_sha1_hmac() | check_sha1_pbkdf2()
+        | check_utf8(utf8_len, expected, expected_count) ) {
+        return 1;
+    }
+    for (uint64_t size = BENCH_AU_MIN_LEN; size <= BENCH_AU_LEN; size *= BENCH_SIZE_STEP) {
+        if ( pack_text(size) ) {
+            return 1;
+        }
+    }
+    free(expected);
+
+    bench("utf8_validate", run_utf8_validate, utf8_len);
+    bench("utf8_decode", run_utf8_decode, utf8_len);
+    memset(data, 'a', BENCH_UTF8_LEN);
+    bench("utf8_validate ascii", run_utf8_validate, BENCH_UTF8_LEN);
+
+    for (uint64_t size = BENCH_AU_MIN_LEN; size <= BENCH_AU_LEN; size *= BENCH_SIZE_STEP) {
+        pack_text(size);
+        bench("compress", run_compress, size);
+        bench("decompress", run_decompress, size);
+    }
+
+    for (uint64_t i = 0; i < data_len; i += 8) {
+        const uint64_t r = next_random(&x);
+        memcpy(data + i, &r, data_len - i < 8 ? data_len - i : 8);
+    }
+    for (uint64_t size = 1; size <= max_size; size *= BENCH_SIZE_STEP) {
+        bench("sha1_hash", run_sha1_hash, size);
+        bench("sha1_update", run_sha1_update, size);
+    }
+    if ( BENCH_DC_LEN <= data_len ) {
+        if ( find_result("sha1_hash", BENCH_DC_LEN) == NULL ) {
+            bench("sha1_hash", run_sha1_hash, BENCH_DC_LEN);
+        }
+        bench("sha1dc_update", run_sha1dc_update, BENCH_DC_LEN);
+    }
+
+    if ( json ) {
+        report_json();
+    } else {
+        report_text();
+    }
+    cio_writer_close(&au_out);
+    free(au_packed);
+    free(au_text);
+    free(codepoints);
+    free(data);
+    return 0;
+}
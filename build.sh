@@ -5,11 +5,92 @@ COMPILER_WARNS="-Warith-conversion -Wcast-align=strict -Wcast-qual -Wshadow -Wst
 COMPILER_PEDANTIC="-Wpedantic"
 COMPILER_FLAGS="-std=c99 ${COMPILER_PEDANTIC} ${COMPILER_WARNS} -Werror"
 
+# Note: profiles (`PROFILE=<name> ./build.sh <prog>`)
+# - debug (default): no optimizations, with debug info
+# - release: optimized, with link time optimization
+# - native: release, tuned for (and only runnable on) this cpu
+# - pgo: release, rebuilt with the profile of a training run
+#   (only aucompress and sha1, see `train`)
+# - prof: release, with the `cutils_prof.h` counters (see `--profile`)
+# None of them defines NDEBUG: some `assert`s do the work.
+PROFILE=${PROFILE:-debug}
+case "${PROFILE}" in
+    debug) PROFILE_FLAGS="-O0 -g" ;;
+    release) PROFILE_FLAGS="-O2 -flto" ;;
+    native) PROFILE_FLAGS="-O3 -march=native -flto" ;;
+    pgo) PROFILE_FLAGS="-O2 -flto" ;;
+    prof) PROFILE_FLAGS="-O2 -flto -DCUTILS_PROFILE" ;;
+    *)
+        echo "Unknown PROFILE '${PROFILE}' (expected debug, release, native, pgo or prof)" >&2
+        exit 1
+        ;;
+esac
+
 set -xe
 
 OUTDIR=${OUTDIR:-./outbin}
 prog="$1"
 shift
 
+# Note: flags needed by some programs
+case "${prog}" in
+    becho) PROG_FLAGS="-pthread" ;;
+    *) PROG_FLAGS="" ;;
+esac
+
+# Note: the last `-o` wins, as in gcc
+out="${OUTDIR}/${prog}"
+prev=""
+for arg in "$@"; do
+    if [ "${prev}" = "-o" ]; then
+        out="${arg}"
+    fi
+    prev="${arg}"
+done
+
+build() {
+    gcc -o "${OUTDIR}/${prog}" ${COMPILER_FLAGS} ${PROFILE_FLAGS} "${prog}/${prog}.c" ${PROG_FLAGS} "$@"
+}
+
+# Note: the training workload is this repository's own text and sources,
+# each file and also all of them concatenated 16 times (about 3 MiB)
+train() {
+    corpus="${PGO_DIR}/corpus"
+    cat COPYING readme.md */*.c */*.h > "${corpus}.1"
+    for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16; do
+        cat "${corpus}.1"
+    done > "${corpus}"
+    case "${prog}" in
+        aucompress)
+            # Note: each file alone, compressed and back
+            # (there is no table reset for long inputs)
+            for f in COPYING readme.md */*.c */*.h; do
+                "${out}" < "${f}" > "${PGO_DIR}/file.Z"
+                "${out}" -d < "${PGO_DIR}/file.Z" > /dev/null
+            done
+            ;;
+        sha1)
+            "${out}" COPYING readme.md */*.c */*.h > /dev/null
+            "${out}" "${corpus}" > /dev/null
+            "${out}" -a sha1,sha256,crc32 "${corpus}" > /dev/null
+            "${out}" -C "${corpus}" > /dev/null
+            "${out}" - < "${corpus}" > /dev/null
+            ;;
+        *)
+            echo "No training workload for ${prog}" >&2
+            exit 1
+            ;;
+    esac
+}
+
 mkdir -p "${OUTDIR}"
-gcc -o "${OUTDIR}/${prog}" ${COMPILER_FLAGS} "${prog}/${prog}.c" "$@"
+if [ "${PROFILE}" = "pgo" ]; then
+    PGO_DIR="${OUTDIR}/pgo-${prog}"
+    rm -rf "${PGO_DIR}"
+    mkdir -p "${PGO_DIR}"
+    build "$@" -fprofile-generate="${PGO_DIR}"
+    train
+    build "$@" -fprofile-use="${PGO_DIR}" -fprofile-partial-training
+else
+    build "$@"
+fi
@@ -0,0 +1,352 @@
+/* cutils_io
+ *
+ * A library of buffered I/O over file descriptors, shared by the tools.
+ * Readers map regular files (`mmap`) read from their start
+ * and read everything else into a large page aligned buffer
+ * (the offset of `fd` ends where the reader stopped, as with `read`);
+ * writers collect the output
+ * in another one, written only when full or on `cio_flush`.
+ * Large writes skip the buffer.
+ * Readers and writers may also work over memory (for benchmarks).
+ * Warning: a mapped file truncated while it is read raises `SIGBUS`
+ * (instead of a short read), fine for tools that read one input through
+ * and die anyway, not for the ones that must report it and go on
+ * (use `read` or `pread` there, as `sha1 -D` does).
+ * Needs POSIX (define `_POSIX_C_SOURCE 200809L` before any include).
+ * To get the implementation of the functions,
+ * define `HASHI_CUTILS_IO_IMPLEMENTATION` before including this file.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASHI_CUTILS_IO_H_
+#define _HASHI_CUTILS_IO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CIO_ALIGN 0x1000
+#define CIO_BUF_LEN 0x40000
+
+/* Note: `data` is the whole input when mapped (or over memory),
+ * otherwise it is `buf` (and `fd` is read into it).
+ * `error` keeps the `errno` of the first failure.
+ */
+typedef struct {
+    int fd;
+    uint8_t *buf;
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    uint8_t mapped;
+    int error;
+} CioReader;
+
+// Note: does not take ownership of `fd`, returns 0 or -1 (see `errno`)
+int cio_reader_open(CioReader *r, int fd);
+void cio_reader_mem(CioReader *r, const uint8_t data[], size_t size);
+void cio_reader_close(CioReader *r);
+
+/* Next chunk of the input (0 at the end or on error),
+ * valid until the next call.
+ * When mapped, it is the rest of the input at once.
+ */
+size_t cio_read(CioReader *r, const uint8_t **data);
+// Note: copies up to `len` bytes, less only at the end
+size_t cio_read_into(CioReader *r, uint8_t dst[], size_t len);
+
+/* Note: with `fd` -1, flushes go to `mem` (when not NULL, growing it)
+ * or are discarded, counting only `total`.
+ */
+typedef struct {
+    int fd;
+    uint8_t *buf;
+    size_t len;
+    uint64_t total;
+    uint8_t *mem;
+    size_t mem_len;
+    size_t mem_cap;
+    int error;
+} CioWriter;
+
+// Note: does not take ownership of `fd`, returns 0 or -1 (see `errno`)
+int cio_writer_open(CioWriter *w, int fd);
+int cio_writer_mem(CioWriter *w, uint8_t keep);
+// Note: flushes, returns 0 or -1 (if any write failed)
+int cio_writer_close(CioWriter *w);
+
+/* Room for `len` (at most `CIO_BUF_LEN`) bytes at `w->buf + w->len`,
+ * to be filled and then committed with `w->len += n`.
+ */
+uint8_t *cio_reserve(CioWriter *w, size_t len);
+void cio_put(CioWriter *w, uint8_t b);
+void cio_write(CioWriter *w, const uint8_t data[], size_t len);
+// Note: writes everything buffered, returns 0 or -1
+int cio_flush(CioWriter *w);
+
+#endif /* _HASHI_CUTILS_IO_H_ */
+
+#ifdef HASHI_CUTILS_IO_IMPLEMENTATION
+#ifndef _HASHI_CUTILS_IO_IMPL_
+#define _HASHI_CUTILS_IO_IMPL_
+
+/* Resources:
+ * - POSIX.1-2008: lseek, mmap, posix_madvise, posix_memalign, read, write
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static
+uint8_t *cio__alloc(void) {
+    void *p = NULL;
+    if (posix_memalign(&p, CIO_ALIGN, CIO_BUF_LEN) != 0) {
+        return NULL;
+    }
+    return p;
+}
+
+int cio_reader_open(CioReader *r, int fd) {
+    struct stat st;
+
+    r->fd = fd;
+    r->buf = NULL;
+    r->data = NULL;
+    r->size = 0;
+    r->pos = 0;
+    r->mapped = 0;
+    r->error = 0;
+
+    /* Note: empty "regular" files (as in /proc) are read, not mapped,
+     * and so are the ones already partly read (by another process sharing `fd`)
+     */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && 0 < st.st_size
+        && lseek(fd, 0, SEEK_CUR) == 0
+        && (uint64_t) st.st_size <= SIZE_MAX) {
+        void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+            r->data = map;
+            r->size = (size_t) st.st_size;
+            r->mapped = 1;
+            return 0;
+        }
+    }
+
+    r->buf = cio__alloc();
+    if (r->buf == NULL) {
+        r->error = ENOMEM;
+        errno = ENOMEM;
+        return -1;
+    }
+    r->data = r->buf;
+    return 0;
+}
+
+void cio_reader_mem(CioReader *r, const uint8_t data[], size_t size) {
+    r->fd = -1;
+    r->buf = NULL;
+    r->data = data;
+    r->size = size;
+    r->pos = 0;
+    r->mapped = 0;
+    r->error = 0;
+}
+
+void cio_reader_close(CioReader *r) {
+    if (r->mapped) {
+        void *map;
+        // Note: moves `fd` past what was consumed, as reading it would have
+        lseek(r->fd, (off_t) r->pos, SEEK_SET);
+        // Note: `munmap` takes a non-const pointer
+        memcpy(&map, &r->data, sizeof(map));
+        munmap(map, r->size);
+    }
+    free(r->buf);
+    r->buf = NULL;
+    r->data = NULL;
+    r->size = 0;
+    r->pos = 0;
+    r->mapped = 0;
+}
+
+static
+size_t cio__fill(CioReader *r, uint8_t dst[], size_t len) {
+    for (;;) {
+        const ssize_t n = read(r->fd, dst, len);
+        if (0 <= n) {
+            return (size_t) n;
+        } else if (errno != EINTR) {
+            r->error = errno;
+            return 0;
+        }
+    }
+}
+
+size_t cio_read(CioReader *r, const uint8_t **data) {
+    if (r->buf == NULL) {
+        const size_t n = r->size - r->pos;
+        *data = r->data + r->pos;
+        r->pos = r->size;
+        return n;
+    }
+    *data = r->buf;
+    return cio__fill(r, r->buf, CIO_BUF_LEN);
+}
+
+size_t cio_read_into(CioReader *r, uint8_t dst[], size_t len) {
+    size_t done = 0;
+    if (r->buf == NULL) {
+        done = len < r->size - r->pos ? len : r->size - r->pos;
+        memcpy(dst, r->data + r->pos, done);
+        r->pos += done;
+        return done;
+    }
+    while (done < len) {
+        const size_t n = cio__fill(r, dst + done, len - done);
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static
+void cio__writer_init(CioWriter *w, int fd) {
+    w->fd = fd;
+    w->buf = NULL;
+    w->len = 0;
+    w->total = 0;
+    w->mem = NULL;
+    w->mem_len = 0;
+    w->mem_cap = 0;
+    w->error = 0;
+}
+
+int cio_writer_open(CioWriter *w, int fd) {
+    cio__writer_init(w, fd);
+    w->buf = cio__alloc();
+    if (w->buf == NULL) {
+        w->error = ENOMEM;
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+int cio_writer_mem(CioWriter *w, uint8_t keep) {
+    const int ret = cio_writer_open(w, -1);
+    if (ret == 0 && keep) {
+        w->mem_cap = CIO_BUF_LEN;
+        w->mem = malloc(w->mem_cap);
+        if (w->mem == NULL) {
+            w->error = ENOMEM;
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    return ret;
+}
+
+// Note: bypasses the buffer
+static
+void cio__output(CioWriter *w, const uint8_t data[], size_t len) {
+    w->total += len;
+    if (w->fd < 0) {
+        if (w->mem == NULL) {
+            return;
+        }
+        if (w->mem_cap - w->mem_len < len) {
+            size_t cap = w->mem_cap;
+            uint8_t *mem;
+            while (cap - w->mem_len < len) {
+                cap *= 2;
+            }
+            mem = realloc(w->mem, cap);
+            if (mem == NULL) {
+                w->error = ENOMEM;
+                return;
+            }
+            w->mem = mem;
+            w->mem_cap = cap;
+        }
+        memcpy(w->mem + w->mem_len, data, len);
+        w->mem_len += len;
+        return;
+    }
+    while (0 < len) {
+        const ssize_t n = write(w->fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            w->error = errno;
+            return;
+        }
+        data += n;
+        len -= (size_t) n;
+    }
+}
+
+int cio_flush(CioWriter *w) {
+    cio__output(w, w->buf, w->len);
+    w->len = 0;
+    return w->error ? -1 : 0;
+}
+
+int cio_writer_close(CioWriter *w) {
+    const int ret = cio_flush(w);
+    free(w->buf);
+    free(w->mem);
+    w->buf = NULL;
+    w->mem = NULL;
+    return ret;
+}
+
+uint8_t *cio_reserve(CioWriter *w, size_t len) {
+    if (CIO_BUF_LEN - w->len < len) {
+        cio_flush(w);
+    }
+    return w->buf + w->len;
+}
+
+void cio_put(CioWriter *w, uint8_t b) {
+    if (w->len == CIO_BUF_LEN) {
+        cio_flush(w);
+    }
+    w->buf[w->len] = b;
+    w->len += 1;
+}
+
+void cio_write(CioWriter *w, const uint8_t data[], size_t len) {
+    if (CIO_BUF_LEN - w->len < len) {
+        cio_flush(w);
+    }
+    if (CIO_BUF_LEN <= len) {
+        cio__output(w, data, len);
+    } else {
+        memcpy(w->buf + w->len, data, len);
+        w->len += len;
+    }
+}
+
+#endif /* _HASHI_CUTILS_IO_IMPL_ */
+#endif /* HASHI_CUTILS_IO_IMPLEMENTATION */
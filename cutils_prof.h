@@ -0,0 +1,178 @@
+/* cutils_prof
+ *
+ * A library of hot path profiling counters, shared by the tools.
+ * A region adds up the cycles (`rdtsc`, or nanoseconds from
+ * `clock_gettime` on other cpus) and the calls between
+ * `PROF_BEGIN` and `PROF_END`; `prof_report` prints all of them
+ * on stderr, with the share of the time since `prof_start`.
+ * Regions may nest (the inner time is also counted by the outer one).
+ * Not thread safe: only use regions on the main thread.
+ *
+ * Only counts when `CUTILS_PROFILE` is defined (`PROFILE=prof ./build.sh`),
+ * otherwise the macros compile to nothing
+ * and `prof_report` only says so.
+ * Needs POSIX (define `_POSIX_C_SOURCE 200809L` before any include).
+ * To get the implementation of the functions,
+ * define `HASHI_CUTILS_PROF_IMPLEMENTATION` before including this file.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASHI_CUTILS_PROF_H_
+#define _HASHI_CUTILS_PROF_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef CUTILS_PROFILE
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_CYCLES 1
+#else
+#define PROF_CYCLES 0
+#endif
+
+typedef struct ProfRegion {
+    const char *name;
+    uint64_t ticks;
+    uint64_t calls;
+    struct ProfRegion *next;
+    uint8_t listed;
+} ProfRegion;
+
+/* Usage (at file scope, then in a function):
+ * PROF_REGION(prof_lookup, "lookup");
+ * PROF_BEGIN(prof_lookup); lookup(x); PROF_END(prof_lookup);
+ */
+#define PROF_REGION(var, label) static ProfRegion var = { label, 0, 0, NULL, 0 }
+#define PROF_BEGIN(var) const uint64_t var##__start = prof_ticks()
+#define PROF_END(var) prof_add(&var, var##__start)
+
+// Note: from `prof_start` to `prof_report`
+void prof_start(void);
+void prof_report(void);
+
+void prof__list(ProfRegion *r);
+
+static inline
+uint64_t prof_ticks(void) {
+#if PROF_CYCLES
+    return __rdtsc();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+#endif
+}
+
+static inline
+void prof_add(ProfRegion *r, const uint64_t start) {
+    r->ticks += prof_ticks() - start;
+    r->calls += 1;
+    if (!r->listed) {
+        prof__list(r);
+    }
+}
+
+#else /* CUTILS_PROFILE */
+
+// Note: a declaration, so `PROF_REGION(...);` is valid at file scope
+#define PROF_REGION(var, label) extern int prof__disabled
+#define PROF_BEGIN(var) (void) 0
+#define PROF_END(var) (void) 0
+
+static inline
+void prof_start(void) {
+}
+
+static inline
+void prof_report(void) {
+    fflush(stdout);
+    fprintf(stderr, "profile: not built in (build with `PROFILE=prof`)\n");
+}
+
+#endif /* CUTILS_PROFILE */
+
+#endif /* _HASHI_CUTILS_PROF_H_ */
+
+#ifdef HASHI_CUTILS_PROF_IMPLEMENTATION
+#ifndef _HASHI_CUTILS_PROF_IMPL_
+#define _HASHI_CUTILS_PROF_IMPL_
+#ifdef CUTILS_PROFILE
+
+/* Resources:
+ * - Intel SDM, Vol. 3B, 18.17 Time-Stamp Counter
+ * - POSIX.1-2008: clock_gettime
+ */
+
+static struct {
+    ProfRegion *head;
+    ProfRegion **tail;
+    uint64_t ticks;
+    uint64_t ns;
+} prof__run = { NULL, &prof__run.head, 0, 0 };
+
+static
+uint64_t prof__ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+// Note: in the order of their first `PROF_END`
+void prof__list(ProfRegion *r) {
+    r->listed = 1;
+    *prof__run.tail = r;
+    prof__run.tail = &r->next;
+}
+
+void prof_start(void) {
+    prof__run.ns = prof__ns();
+    prof__run.ticks = prof_ticks();
+}
+
+// Note: flushes stdout first, so the report comes after the output
+void prof_report(void) {
+    const uint64_t ticks = prof_ticks() - prof__run.ticks;
+    const uint64_t ns = prof__ns() - prof__run.ns;
+    // Note: converts ticks to time with the rate measured over the whole run
+    const double ns_per_tick = ticks ? (double) ns / (double) ticks : 0.0;
+
+    fflush(stdout);
+    fprintf(stderr, "profile: %.3f ms", (double) ns / 1e6);
+    if (PROF_CYCLES && ns) {
+        fprintf(stderr, ", %llu cycles (%.2f GHz)",
+            (unsigned long long) ticks, (double) ticks / (double) ns);
+    }
+    fprintf(stderr, "\n%-26s %12s %14s %10s %10s %6s\n",
+        "region", "calls", PROF_CYCLES ? "cycles" : "ns", "per call", "ms", "share");
+    for (const ProfRegion *r = prof__run.head; r != NULL; r = r->next) {
+        fprintf(stderr, "%-26s %12llu %14llu %10.1f %10.3f %5.1f%%\n",
+            r->name,
+            (unsigned long long) r->calls,
+            (unsigned long long) r->ticks,
+            r->calls ? (double) r->ticks / (double) r->calls : 0.0,
+            (double) r->ticks * ns_per_tick / 1e6,
+            ticks ? 100.0 * (double) r->ticks / (double) ticks : 0.0
+        );
+    }
+}
+
+#endif /* CUTILS_PROFILE */
+#endif /* _HASHI_CUTILS_PROF_IMPL_ */
+#endif /* HASHI_CUTILS_PROF_IMPLEMENTATION */
@@ -0,0 +1,145 @@
+/* crc32
+ *
+ * A library of crc32 checksum (IEEE 802.3, the one of zlib and `cksum -a crc32b`),
+ * companion of `sha1.h` with the same interface.
+ * Uses slicing-by-8, with the tables built at compile time (thread safe, no init).
+ * To get the implementation of the functions,
+ * define `HASHI_CRC32_IMPLEMENTATION` before including this file.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASHI_CRC32_H_
+#define _HASHI_CRC32_H_
+
+#include <stdint.h>
+
+/* Note: digest is the crc in big-endian, as it is usually printed */
+#define CRC32_DIGEST_LEN 4
+
+typedef struct {
+    uint32_t crc;
+    uint64_t size;
+} Crc32State;
+
+void crc32_hash(const uint8_t data[], uint64_t size, uint8_t out[CRC32_DIGEST_LEN]);
+
+void crc32_init(Crc32State *s);
+
+void crc32_update(Crc32State *s, const uint8_t data[], uint64_t size);
+void crc32_finish(Crc32State *s, uint8_t out[CRC32_DIGEST_LEN]);
+
+#endif /* _HASHI_CRC32_H_ */
+
+#ifdef HASHI_CRC32_IMPLEMENTATION
+#ifndef _HASHI_CRC32_IMPL_
+#define _HASHI_CRC32_IMPL_
+
+/* Resources:
+ * - https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+ * - Intel, "A Systematic Approach to Building High Performance
+ *   Software-based CRC Generators" (slicing-by-8)
+ */
+
+/* Note: the tables are linear (over xor) in the byte,
+ * so each entry is the xor of the entries of its set bits:
+ * a row is built from its 8 entries at 0x01, 0x02, ..., 0x80
+ * (`crc32__table[t][n]` is the crc of byte n followed by t zero bytes,
+ * of polynomial 0xEDB88320, without the initial and final xor)
+ */
+#define CRC32__ENTRY(n, k0, k1, k2, k3, k4, k5, k6, k7) ( \
+    (((n) & 0x01) ? (k0) : 0) ^ (((n) & 0x02) ? (k1) : 0) \
+    ^ (((n) & 0x04) ? (k2) : 0) ^ (((n) & 0x08) ? (k3) : 0) \
+    ^ (((n) & 0x10) ? (k4) : 0) ^ (((n) & 0x20) ? (k5) : 0) \
+    ^ (((n) & 0x40) ? (k6) : 0) ^ (((n) & 0x80) ? (k7) : 0) \
+)
+#define CRC32__ROW4(n, ...) \
+    CRC32__ENTRY((n), __VA_ARGS__), CRC32__ENTRY((n)+1, __VA_ARGS__), \
+    CRC32__ENTRY((n)+2, __VA_ARGS__), CRC32__ENTRY((n)+3, __VA_ARGS__)
+#define CRC32__ROW16(n, ...) \
+    CRC32__ROW4((n), __VA_ARGS__), CRC32__ROW4((n)+4, __VA_ARGS__), \
+    CRC32__ROW4((n)+8, __VA_ARGS__), CRC32__ROW4((n)+12, __VA_ARGS__)
+#define CRC32__ROW64(n, ...) \
+    CRC32__ROW16((n), __VA_ARGS__), CRC32__ROW16((n)+16, __VA_ARGS__), \
+    CRC32__ROW16((n)+32, __VA_ARGS__), CRC32__ROW16((n)+48, __VA_ARGS__)
+#define CRC32__ROW(...) { \
+    CRC32__ROW64(0, __VA_ARGS__), CRC32__ROW64(64, __VA_ARGS__), \
+    CRC32__ROW64(128, __VA_ARGS__), CRC32__ROW64(192, __VA_ARGS__) \
+}
+
+static const uint32_t crc32__table[8][0x100] = {
+    CRC32__ROW(0x77073096u, 0xEE0E612Cu, 0x076DC419u, 0x0EDB8832u, 0x1DB71064u, 0x3B6E20C8u, 0x76DC4190u, 0xEDB88320u),
+    CRC32__ROW(0x191B3141u, 0x32366282u, 0x646CC504u, 0xC8D98A08u, 0x4AC21251u, 0x958424A2u, 0xF0794F05u, 0x3B83984Bu),
+    CRC32__ROW(0x01C26A37u, 0x0384D46Eu, 0x0709A8DCu, 0x0E1351B8u, 0x1C26A370u, 0x384D46E0u, 0x709A8DC0u, 0xE1351B80u),
+    CRC32__ROW(0xB8BC6765u, 0xAA09C88Bu, 0x8F629757u, 0xC5B428EFu, 0x5019579Fu, 0xA032AF3Eu, 0x9B14583Du, 0xED59B63Bu),
+    CRC32__ROW(0x3D6029B0u, 0x7AC05360u, 0xF580A6C0u, 0x30704BC1u, 0x60E09782u, 0xC1C12F04u, 0x58F35849u, 0xB1E6B092u),
+    CRC32__ROW(0xCB5CD3A5u, 0x4DC8A10Bu, 0x9B914216u, 0xEC53826Du, 0x03D6029Bu, 0x07AC0536u, 0x0F580A6Cu, 0x1EB014D8u),
+    CRC32__ROW(0xA6770BB4u, 0x979F1129u, 0xF44F2413u, 0x33EF4E67u, 0x67DE9CCEu, 0xCFBD399Cu, 0x440B7579u, 0x8816EAF2u),
+    CRC32__ROW(0xCCAA009Eu, 0x4225077Du, 0x844A0EFAu, 0xD3E51BB5u, 0x7CBB312Bu, 0xF9766256u, 0x299DC2EDu, 0x533B85DAu),
+};
+
+#undef CRC32__ENTRY
+#undef CRC32__ROW4
+#undef CRC32__ROW16
+#undef CRC32__ROW64
+#undef CRC32__ROW
+
+void crc32_hash(const uint8_t data[], uint64_t size, uint8_t out[CRC32_DIGEST_LEN]) {
+    Crc32State s;
+    crc32_init(&s);
+    crc32_update(&s, data, size);
+    crc32_finish(&s, out);
+}
+
+void crc32_init(Crc32State *s) {
+    s->crc = 0xFFFFFFFF;
+    s->size = 0;
+}
+
+void crc32_update(Crc32State *s, const uint8_t data[], uint64_t size) {
+    uint32_t crc = s->crc;
+    uint64_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        const uint32_t one = crc ^ (
+            ((uint32_t) data[i+0] << 0) | ((uint32_t) data[i+1] << 8)
+            | ((uint32_t) data[i+2] << 16) | ((uint32_t) data[i+3] << 24)
+        );
+        const uint32_t two =
+            ((uint32_t) data[i+4] << 0) | ((uint32_t) data[i+5] << 8)
+            | ((uint32_t) data[i+6] << 16) | ((uint32_t) data[i+7] << 24);
+        crc = crc32__table[7][(one >> 0) & 0xFF] ^ crc32__table[6][(one >> 8) & 0xFF]
+            ^ crc32__table[5][(one >> 16) & 0xFF] ^ crc32__table[4][(one >> 24) & 0xFF]
+            ^ crc32__table[3][(two >> 0) & 0xFF] ^ crc32__table[2][(two >> 8) & 0xFF]
+            ^ crc32__table[1][(two >> 16) & 0xFF] ^ crc32__table[0][(two >> 24) & 0xFF];
+    }
+
+    for (; i < size; i += 1) {
+        crc = (crc >> 8) ^ crc32__table[0][(crc ^ data[i]) & 0xFF];
+    }
+
+    s->crc = crc;
+    s->size += size;
+}
+
+void crc32_finish(Crc32State *s, uint8_t out[CRC32_DIGEST_LEN]) {
+    const uint32_t crc = s->crc ^ 0xFFFFFFFF;
+    for (uint8_t i = 0; i < CRC32_DIGEST_LEN; i += 1) {
+        out[i] = (crc >> (8*(CRC32_DIGEST_LEN-1-i))) & 0xFF;
+    }
+}
+
+#endif /* _HASHI_CRC32_IMPL_ */
+#endif /* HASHI_CRC32_IMPLEMENTATION */
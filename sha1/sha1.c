@@ -1,2 +1,5 @@
+/* Note: the executable walks directories (`-D`) and maps files, which is POSIX */
+#define _POSIX_C_SOURCE 200809L
+
 #define HASHI_SHA1_EXE
 #include "sha1.h"
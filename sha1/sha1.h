@@ -1,10 +1,17 @@
 /* sha1
  *
- * A library of sha1 hashing algorithm.
+ * A library of sha1 hashing algorithm,
+ * with HMAC-SHA1 and PBKDF2-HMAC-SHA1 on top of it.
  * To get the implementation of the functions,
  * define `HASHI_SHA1_IMPLEMENTATION` before including this file.
  *
- * Also has a simple implementation of `sha1sum` (no support for flags).
+ * Also has a simple implementation of `sha1sum`.
+ * With `-a sha1,sha256,crc32` (any subset), computes the chosen digests
+ * in a single pass over each input (see `sha256.h` and `crc32.h`).
+ * With `-D [dir...]`, prints groups of duplicated files, one per line.
+ * With `-C`, detects chunks of known collision attacks (see `sha1dc_*`),
+ * warning on stderr and exiting with 1.
+ * With `--profile`, prints where the time went on stderr (see `cutils_prof.h`).
  * For the implementation, define `HASHI_SHA1_EXE` before including this file.
  *
  * Copyright (C) 2025 Daniel K Hashimoto
@@ -48,6 +55,57 @@ void sha1_init(Sha1State *s);
 void sha1_update(Sha1State *s, const uint8_t data[], uint64_t size);
 void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]);
 
+/* SHA-1 with collision detection (in the style of SHA-1DC)
+ *
+ * Same digest as `sha1_*`, but `sha1dc_finish` (and `sha1dc_hash`)
+ * return 1 when some chunk completes a collision of a known
+ * cryptanalytic attack (as SHAttered), 0 otherwise.
+ * On a collision the digest is the "safe hash" of SHA-1DC instead
+ * (that chunk compressed 3 times), so colliding inputs differ.
+ * Thread safe (the tables are built at compile time).
+ */
+typedef struct {
+    Sha1State s;
+    uint8_t collision;
+} Sha1DcState;
+
+uint8_t sha1dc_hash(const uint8_t data[], uint64_t size, uint8_t out[SHA1_DIGEST_LEN]);
+
+void sha1dc_init(Sha1DcState *s);
+
+void sha1dc_update(Sha1DcState *s, const uint8_t data[], uint64_t size);
+uint8_t sha1dc_finish(Sha1DcState *s, uint8_t out[SHA1_DIGEST_LEN]);
+
+/* HMAC-SHA1 (RFC 2104)
+ *
+ * `sha1_hmac_key` absorbs the ipad and opad blocks once per key,
+ * `sha1_hmac_init` clones the ipad state for each new message
+ * and `sha1_hmac_finish` clones the opad state to close it.
+ * Between them, use `sha1_update` as usual.
+ */
+typedef struct {
+    Sha1State inner;
+    Sha1State outer;
+} Sha1HmacKey;
+
+void sha1_hmac_key(Sha1HmacKey *k, const uint8_t key[], uint64_t key_size);
+
+void sha1_hmac_init(Sha1State *s, const Sha1HmacKey *k);
+void sha1_hmac_finish(Sha1State *s, const Sha1HmacKey *k, uint8_t out[SHA1_DIGEST_LEN]);
+
+void sha1_hmac(const Sha1HmacKey *k, const uint8_t data[], uint64_t size, uint8_t out[SHA1_DIGEST_LEN]);
+
+/* PBKDF2-HMAC-SHA1 (RFC 8018), `out_size` bytes of derived key.
+ * Returns 1 (writing nothing) when `out_size` is above `SHA1_PBKDF2_MAX_LEN`.
+ */
+#define SHA1_PBKDF2_MAX_LEN (0xFFFFFFFFULL * SHA1_DIGEST_LEN)
+uint8_t sha1_pbkdf2(
+    const uint8_t password[], uint64_t password_size,
+    const uint8_t salt[], uint64_t salt_size,
+    uint32_t iterations,
+    uint8_t out[], uint64_t out_size
+);
+
 #endif /* _HASHI_SHA1_H_ */
 
 #ifdef HASHI_SHA1_EXE
@@ -55,52 +113,662 @@ void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]);
 #ifndef _HASHI_SHA1_EXE_
 #define _HASHI_SHA1_EXE_
 #define HASHI_SHA1_IMPLEMENTATION
+#define HASHI_SHA256_IMPLEMENTATION
+#define HASHI_CRC32_IMPLEMENTATION
+#define HASHI_CUTILS_IO_IMPLEMENTATION
+#define HASHI_CUTILS_PROF_IMPLEMENTATION
+
+#include "sha256.h"
+#include "crc32.h"
+#include "../cutils_io.h"
+#include "../cutils_prof.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include <assert.h>
+#include <errno.h>
+
+/* Digests computed by a single pass over the input (flag `-a`) */
+typedef enum {
+    DIGEST_SHA1 = 1 << 0,
+    DIGEST_SHA256 = 1 << 1,
+    DIGEST_CRC32 = 1 << 2,
+} DigestKind;
 
-void run(Sha1State *s, FILE *fin, const char *filename, uint8_t *buf, uint64_t buf_len, uint8_t out[SHA1_DIGEST_LEN]) {
-    sha1_init(s);
+typedef struct {
+    uint8_t kinds; /* DigestKind */
+    uint8_t detect; /* sha1 with collision detection (flag `-C`) */
+    Sha1State sha1;
+    Sha1DcState sha1dc;
+    Sha256State sha256;
+    Crc32State crc32;
+} Digests;
 
-    while (!feof(fin)) {
-        size_t n = fread(buf, sizeof(buf[0]), buf_len, fin);
-        sha1_update(s, buf, n);
+static const struct {
+    DigestKind kind;
+    const char *name;
+    const char *tag;
+} digest_names[] = {
+    { DIGEST_SHA1, "sha1", "SHA1" },
+    { DIGEST_SHA256, "sha256", "SHA256" },
+    { DIGEST_CRC32, "crc32", "CRC32" },
+};
+#define DIGEST_NAMES_LEN (sizeof(digest_names)/sizeof(digest_names[0]))
+
+// Note: as in "(expected sha1, sha256 or crc32)"
+void print_digest_names(void) {
+    fprintf(stderr, "(expected");
+    for (uint8_t i = 0; i < DIGEST_NAMES_LEN; i += 1) {
+        const char *sep = i == 0 ? " " : i + 1 == DIGEST_NAMES_LEN ? " or " : ", ";
+        fprintf(stderr, "%s%s", sep, digest_names[i].name);
     }
+    fprintf(stderr, ")\n");
+}
 
-    sha1_finish(s, out);
+/* Parses a comma separated list of digest names, returns 0 on error
+ * (empty names included, as in `-a ''` or `-a sha1,`)
+ */
+uint8_t parse_digests(const char *list) {
+    uint8_t kinds = 0;
+    for (;;) {
+        const char *comma = strchr(list, ',');
+        const size_t len = comma ? (size_t) (comma - list) : strlen(list);
+        uint8_t found = 0;
+        for (uint8_t i = 0; i < DIGEST_NAMES_LEN; i += 1) {
+            if (strlen(digest_names[i].name) == len && strncmp(digest_names[i].name, list, len) == 0) {
+                kinds |= digest_names[i].kind;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "sha1: unknown digest '%.*s' ", (int) len, list);
+            print_digest_names();
+            return 0;
+        }
+        if (comma == NULL) {
+            return kinds;
+        }
+        list = comma + 1;
+    }
+}
 
-    for (uint8_t i = 0; i < SHA1_DIGEST_LEN; i += 1) {
+void print_hex(const uint8_t out[], uint8_t len) {
+    for (uint8_t i = 0; i < len; i += 1) {
         printf("%02hhx", out[i]);
     }
+}
+
+void digests_sha1_init(Digests *d) {
+    if (d->detect) {
+        sha1dc_init(&d->sha1dc);
+    } else {
+        sha1_init(&d->sha1);
+    }
+}
+
+// Note: the library has no counters, the rounds are timed from here
+PROF_REGION(prof_sha1, "sha1_update");
+
+void digests_sha1_update(Digests *d, const uint8_t data[], uint64_t size) {
+    PROF_BEGIN(prof_sha1);
+    if (d->detect) {
+        sha1dc_update(&d->sha1dc, data, size);
+    } else {
+        sha1_update(&d->sha1, data, size);
+    }
+    PROF_END(prof_sha1);
+}
+
+/* Returns 1 (and warns) when a collision attack was detected */
+uint8_t digests_sha1_finish(Digests *d, const char *filename, uint8_t out[SHA1_DIGEST_LEN]) {
+    if (d->detect) {
+        const uint8_t collision = sha1dc_finish(&d->sha1dc, out);
+        if (collision) {
+            fprintf(stderr, "sha1: %s: collision attack detected\n", filename);
+        }
+        return collision;
+    } else {
+        sha1_finish(&d->sha1, out);
+        return 0;
+    }
+}
+
+PROF_REGION(prof_io, "I/O loop");
+
+/* Note: a read error of `fin` (after its loop) is printed, returning 1 */
+uint8_t read_failed(const CioReader *fin, const char *filename) {
+    if (fin->error != 0) {
+        fprintf(stderr, "sha1: %s: %s\n", filename, strerror(fin->error));
+        return 1;
+    }
+    return 0;
+}
+
+/* Both return 1 on a read error (printing no digest) or a collision */
+uint8_t run_digests(Digests *d, CioReader *fin, const char *filename) {
+    uint8_t out[SHA256_DIGEST_LEN];
+    uint8_t collision = 0;
+    const uint8_t *buf;
+    size_t n;
+
+    if (d->kinds & DIGEST_SHA1) {
+        digests_sha1_init(d);
+    }
+    if (d->kinds & DIGEST_SHA256) {
+        sha256_init(&d->sha256);
+    }
+    if (d->kinds & DIGEST_CRC32) {
+        crc32_init(&d->crc32);
+    }
+
+    PROF_BEGIN(prof_io);
+    while ((n = cio_read(fin, &buf)) > 0) {
+        if (d->kinds & DIGEST_SHA1) {
+            digests_sha1_update(d, buf, n);
+        }
+        if (d->kinds & DIGEST_SHA256) {
+            sha256_update(&d->sha256, buf, n);
+        }
+        if (d->kinds & DIGEST_CRC32) {
+            crc32_update(&d->crc32, buf, n);
+        }
+    }
+    PROF_END(prof_io);
+    if (read_failed(fin, filename)) {
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < DIGEST_NAMES_LEN; i += 1) {
+        uint8_t len = 0;
+        switch (d->kinds & digest_names[i].kind) {
+            case DIGEST_SHA1: {
+                collision = digests_sha1_finish(d, filename, out);
+                len = SHA1_DIGEST_LEN;
+            } break;
+            case DIGEST_SHA256: {
+                sha256_finish(&d->sha256, out);
+                len = SHA256_DIGEST_LEN;
+            } break;
+            case DIGEST_CRC32: {
+                crc32_finish(&d->crc32, out);
+                len = CRC32_DIGEST_LEN;
+            } break;
+            default: {
+                continue;
+            }
+        }
+        printf("%s (%s) = ", digest_names[i].tag, filename);
+        print_hex(out, len);
+        printf("\n");
+    }
+    return collision;
+}
+
+uint8_t run(Digests *d, CioReader *fin, const char *filename, uint8_t out[SHA1_DIGEST_LEN]) {
+    uint8_t collision;
+    const uint8_t *buf;
+    size_t n;
+    digests_sha1_init(d);
+
+    PROF_BEGIN(prof_io);
+    while ((n = cio_read(fin, &buf)) > 0) {
+        digests_sha1_update(d, buf, n);
+    }
+    PROF_END(prof_io);
+    if (read_failed(fin, filename)) {
+        return 1;
+    }
+
+    collision = digests_sha1_finish(d, filename, out);
+
+    print_hex(out, SHA1_DIGEST_LEN);
     printf("  %s\n", filename);
+    return collision;
 }
 
-int main(const int argc, const char *argv[]) {
+/* Note: regular files are mapped, anything else is read in large blocks.
+ * Returns 1 when the file could not be opened or read, or has a collision.
+ */
+uint8_t run_file(Digests *d, const char *filename) {
+    uint8_t failed;
+    const uint8_t is_stdin = filename[0] == '-' && filename[1] == '\0';
+    CioReader fin;
+    int fd = STDIN_FILENO;
+    if (!is_stdin) {
+        fd = open(filename, O_RDONLY);
+    }
+    if (fd < 0 || cio_reader_open(&fin, fd) != 0) {
+        fprintf(stderr, "sha1: %s: %s\n", filename, strerror(errno));
+        if (!is_stdin && 0 <= fd) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    if (d->kinds == 0) {
+        uint8_t out[SHA1_DIGEST_LEN];
+        failed = run(d, &fin, filename, out);
+    } else {
+        failed = run_digests(d, &fin, filename);
+    }
+
+    cio_reader_close(&fin);
+    if (!is_stdin) {
+        close(fd);
+    }
+    return failed;
+}
+
+/* Duplicate finder (flag `-D`)
+ *
+ * Files are compared in tiers, each one only over the files
+ * still tied after the previous:
+ * 1. size (from `lstat`, no reads);
+ * 2. sha1 of the first and last `DUP_PARTIAL_LEN` bytes;
+ * 3. sha1 of the whole file.
+ * Empty files and symbolic links are ignored, and a file seen more than once
+ * (repeated arguments, hard links: same `st_dev` and `st_ino`)
+ * is only kept under its first path in byte order.
+ * Groups are printed sorted by path, each group ordered by its first path.
+ */
+#define DUP_PARTIAL_LEN 0x1000
+#define DUP_BUF_LEN 0x10000
+/* Note: a `dup_hash_range` error, the file ended before its `lstat` size */
+#define DUP_SHORT_READ (-1)
+
+typedef struct {
+    char *path;
+    uint64_t size;
+    dev_t dev;
+    ino_t ino;
+    uint8_t ok;
+    uint8_t partial[SHA1_DIGEST_LEN];
+    uint8_t full[SHA1_DIGEST_LEN];
+} DupFile;
+
+typedef struct {
+    DupFile *items;
+    size_t len;
+    size_t cap;
+} DupFiles;
+
+/* Note: a group of duplicates, `len` items from `start` */
+typedef struct {
+    size_t start;
+    size_t len;
+} DupGroup;
+
+typedef struct {
+    DupGroup *items;
+    size_t len;
+    size_t cap;
+} DupGroups;
+
+static uint8_t dup_buf[DUP_BUF_LEN];
+
+void dup_push(DupFiles *fs, char *path, const struct stat *st) {
+    if (fs->len == fs->cap) {
+        fs->cap = fs->cap ? 2*fs->cap : 0x100;
+        fs->items = realloc(fs->items, fs->cap * sizeof(fs->items[0]));
+        assert(fs->items);
+    }
+    fs->items[fs->len] = (DupFile){
+        .path = path,
+        .size = (uint64_t) st->st_size,
+        .dev = st->st_dev,
+        .ino = st->st_ino,
+        .ok = 1,
+    };
+    fs->len += 1;
+}
+
+/* Returns 1 when a directory or entry could not be read (printing why) */
+uint8_t dup_walk(DupFiles *fs, const char *dirname) {
+    DIR *dir = opendir(dirname);
+    struct dirent *entry;
+    uint8_t failed = 0;
+    if (!dir) {
+        perror(dirname);
+        return 1;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        struct stat st;
+        char *path;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+
+        {
+            const size_t dir_len = strlen(dirname);
+            const size_t name_len = strlen(name);
+            const uint8_t needs_sep = dir_len == 0 || dirname[dir_len - 1] != '/';
+            path = malloc(dir_len + needs_sep + name_len + 1);
+            assert(path);
+            memcpy(path, dirname, dir_len);
+            path[dir_len] = '/';
+            memcpy(path + dir_len + needs_sep, name, name_len + 1);
+        }
+
+        if (lstat(path, &st) != 0) {
+            perror(path);
+            free(path);
+            failed = 1;
+        } else if (S_ISDIR(st.st_mode)) {
+            failed |= dup_walk(fs, path);
+            free(path);
+        } else if (S_ISREG(st.st_mode) && 0 < st.st_size) {
+            dup_push(fs, path, &st);
+        } else {
+            free(path);
+        }
+    }
+    closedir(dir);
+    return failed;
+}
+
+/* Prints a tier error, `DUP_SHORT_READ` or an errno */
+void dup_error(DupFile *f, const int error) {
+    if (error == DUP_SHORT_READ) {
+        fprintf(stderr, "%s: short read (changed while reading?)\n", f->path);
+    } else {
+        fprintf(stderr, "%s: %s\n", f->path, strerror(error));
+    }
+    f->ok = 0;
+}
+
+/* Hashes `len` bytes of `fd` starting at `offset` (with `pread`, no seeks),
+ * returns 0, an errno or `DUP_SHORT_READ`
+ */
+int dup_hash_range(Sha1State *s, int fd, uint64_t offset, uint64_t len) {
+    while (0 < len) {
+        const size_t want = len < DUP_BUF_LEN ? (size_t) len : DUP_BUF_LEN;
+        const ssize_t n = pread(fd, dup_buf, want, (off_t) offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            return errno;
+        } else if (n == 0) {
+            return DUP_SHORT_READ;
+        }
+        sha1_update(s, dup_buf, (size_t) n);
+        offset += (uint64_t) n;
+        len -= (uint64_t) n;
+    }
+    return 0;
+}
+
+/* Tier 2, for small files it already is the full hash */
+void dup_hash_partial(DupFile *f) {
     Sha1State s;
-    uint8_t buf[SHA1_CHUNK_LEN];
-    uint8_t out[SHA1_DIGEST_LEN];
-
-    if(1 < argc) {
-        for (int i = 1; i < argc; i += 1) {
-            const char *filename = argv[i];
-            const uint8_t is_stdin = filename[0] == '-' && filename[1] == '\0';
-            FILE *fin = stdin;
-            if (!is_stdin) {
-                fin = fopen(filename, "rb");
+    const int fd = open(f->path, O_RDONLY);
+    int error = fd < 0 ? errno : 0;
+    sha1_init(&s);
+    if (error == 0 && f->size <= 2*DUP_PARTIAL_LEN) {
+        error = dup_hash_range(&s, fd, 0, f->size);
+    } else if (error == 0) {
+        error = dup_hash_range(&s, fd, 0, DUP_PARTIAL_LEN);
+        if (error == 0) {
+            error = dup_hash_range(&s, fd, f->size - DUP_PARTIAL_LEN, DUP_PARTIAL_LEN);
+        }
+    }
+    if (0 <= fd) {
+        close(fd);
+    }
+    if (error != 0) {
+        dup_error(f, error);
+    }
+    sha1_finish(&s, f->partial);
+}
+
+/* Tier 3, read (not mapped): a file truncated meanwhile is a short read, not a `SIGBUS` */
+void dup_hash_full(DupFile *f) {
+    Sha1State s;
+    const int fd = open(f->path, O_RDONLY);
+    int error = fd < 0 ? errno : 0;
+    sha1_init(&s);
+    if (error == 0) {
+        error = dup_hash_range(&s, fd, 0, f->size);
+        close(fd);
+    }
+    if (error != 0) {
+        dup_error(f, error);
+    }
+    sha1_finish(&s, f->full);
+}
+
+int dup_cmp_size(const void *a, const void *b) {
+    const DupFile *fa = a;
+    const DupFile *fb = b;
+    return (fa->size > fb->size) - (fa->size < fb->size);
+}
+
+/* Note: the same file (by `st_dev` and `st_ino`) ends up next to itself */
+int dup_order_size(const void *a, const void *b) {
+    const DupFile *fa = a;
+    const DupFile *fb = b;
+    int cmp = dup_cmp_size(a, b);
+    if (cmp == 0) {
+        cmp = (fa->dev > fb->dev) - (fa->dev < fb->dev);
+    }
+    if (cmp == 0) {
+        cmp = (fa->ino > fb->ino) - (fa->ino < fb->ino);
+    }
+    return cmp != 0 ? cmp : strcmp(fa->path, fb->path);
+}
+
+/* Note: files that failed to read sort last and never match */
+int dup_cmp_partial(const void *a, const void *b) {
+    const DupFile *fa = a;
+    const DupFile *fb = b;
+    if (fa->ok != fb->ok) {
+        return fb->ok - fa->ok;
+    }
+    return memcmp(fa->partial, fb->partial, SHA1_DIGEST_LEN);
+}
+
+int dup_cmp_full(const void *a, const void *b) {
+    const DupFile *fa = a;
+    const DupFile *fb = b;
+    if (fa->ok != fb->ok) {
+        return fb->ok - fa->ok;
+    }
+    return memcmp(fa->full, fb->full, SHA1_DIGEST_LEN);
+}
+
+/* Note: `dup_order_*` sort by the `dup_cmp_*` key, then by path */
+int dup_order_partial(const void *a, const void *b) {
+    const int cmp = dup_cmp_partial(a, b);
+    return cmp != 0 ? cmp : strcmp(((const DupFile *) a)->path, ((const DupFile *) b)->path);
+}
+
+int dup_order_full(const void *a, const void *b) {
+    const int cmp = dup_cmp_full(a, b);
+    return cmp != 0 ? cmp : strcmp(((const DupFile *) a)->path, ((const DupFile *) b)->path);
+}
+
+/* Length of the run of files equal to `fs[0]` under `cmp` */
+size_t dup_run_len(const DupFile fs[], size_t len, int (*cmp)(const void *, const void *)) {
+    size_t n = 1;
+    while (n < len && fs[0].ok && cmp(&fs[0], &fs[n]) == 0) {
+        n += 1;
+    }
+    return n;
+}
+
+void dup_push_group(DupGroups *gs, size_t start, size_t len) {
+    if (gs->len == gs->cap) {
+        gs->cap = gs->cap ? 2*gs->cap : 0x40;
+        gs->items = realloc(gs->items, gs->cap * sizeof(gs->items[0]));
+        assert(gs->items);
+    }
+    gs->items[gs->len] = (DupGroup){ .start = start, .len = len };
+    gs->len += 1;
+}
+
+/* Note: a group is sorted by path, so its first path is the smallest */
+static const DupFile *dup_group_files;
+
+int dup_order_group(const void *a, const void *b) {
+    const DupGroup *ga = a;
+    const DupGroup *gb = b;
+    return strcmp(dup_group_files[ga->start].path, dup_group_files[gb->start].path);
+}
+
+void dup_print_group(const DupFile fs[], size_t len) {
+    for (size_t i = 0; i < len; i += 1) {
+        printf(i == 0 ? "%s" : "\t%s", fs[i].path);
+    }
+    printf("\n");
+}
+
+/* Drops the repeated files (adjacent after `dup_order_size`), keeping the first path */
+void dup_unique(DupFiles *fs) {
+    size_t len = 0;
+    for (size_t i = 0; i < fs->len; i += 1) {
+        const DupFile *f = &fs->items[i];
+        if (0 < len && fs->items[len - 1].dev == f->dev && fs->items[len - 1].ino == f->ino) {
+            free(f->path);
+        } else {
+            fs->items[len] = *f;
+            len += 1;
+        }
+    }
+    fs->len = len;
+}
+
+void dup_find(DupFiles *fs) {
+    DupGroups groups = {0};
+    DupFile *items;
+    qsort(fs->items, fs->len, sizeof(fs->items[0]), dup_order_size);
+    dup_unique(fs);
+    items = fs->items;
+
+    for (size_t i = 0; i < fs->len;) {
+        const size_t size_len = dup_run_len(items + i, fs->len - i, dup_cmp_size);
+        if (size_len < 2) {
+            i += size_len;
+            continue;
+        }
+
+        for (size_t j = i; j < i + size_len; j += 1) {
+            dup_hash_partial(&items[j]);
+        }
+        qsort(items + i, size_len, sizeof(items[0]), dup_order_partial);
+
+        for (size_t j = i; j < i + size_len;) {
+            const size_t partial_len = dup_run_len(items + j, i + size_len - j, dup_cmp_partial);
+            if (partial_len < 2) {
+                // Empty
+            } else if (items[j].size <= 2*DUP_PARTIAL_LEN) {
+                dup_push_group(&groups, j, partial_len);
+            } else {
+                for (size_t k = j; k < j + partial_len; k += 1) {
+                    dup_hash_full(&items[k]);
+                }
+                qsort(items + j, partial_len, sizeof(items[0]), dup_order_full);
+
+                for (size_t k = j; k < j + partial_len;) {
+                    const size_t full_len = dup_run_len(items + k, j + partial_len - k, dup_cmp_full);
+                    if (2 <= full_len) {
+                        dup_push_group(&groups, k, full_len);
+                    }
+                    k += full_len;
+                }
             }
-            assert(fin);
+            j += partial_len;
+        }
+        i += size_len;
+    }
+
+    dup_group_files = items;
+    qsort(groups.items, groups.len, sizeof(groups.items[0]), dup_order_group);
+    for (size_t g = 0; g < groups.len; g += 1) {
+        dup_print_group(items + groups.items[g].start, groups.items[g].len);
+    }
+    free(groups.items);
+}
+
+/* Note: exits with 1 when the audit is incomplete
+ * (an argument, directory or file that could not be read)
+ */
+int run_dup(const int argc, const char *argv[]) {
+    DupFiles fs = {0};
+    uint8_t failed = 0;
+    if (argc == 0) {
+        failed |= dup_walk(&fs, ".");
+    }
+    for (int i = 0; i < argc; i += 1) {
+        failed |= dup_walk(&fs, argv[i]);
+    }
+
+    dup_find(&fs);
+
+    for (size_t i = 0; i < fs.len; i += 1) {
+        failed |= !fs.items[i].ok;
+        free(fs.items[i].path);
+    }
+    free(fs.items);
+    return failed;
+}
+
+int main(const int argc, const char *argv[]) {
+    Digests d;
+    uint8_t failed = 0;
+    uint8_t profile = 0;
+    int i = 1;
 
-            run(&s, fin, filename, buf, sizeof(buf)/sizeof(buf[0]), out);
+    prof_start();
+    if (i < argc && strcmp(argv[i], "--profile") == 0) {
+        profile = 1;
+        i += 1;
+    }
 
-            if (!is_stdin) {
-                fclose(fin);
+    if (i < argc && strcmp(argv[i], "-D") == 0) {
+        const int ret = run_dup(argc - (i + 1), argv + i + 1);
+        if (profile) {
+            prof_report();
+        }
+        return ret;
+    }
+
+    /* Note: no `-a` keeps the plain `sha1sum` output */
+    d.kinds = 0;
+    d.detect = 0;
+    while (i < argc) {
+        if (i + 1 < argc && strcmp(argv[i], "-a") == 0) {
+            d.kinds = parse_digests(argv[i + 1]);
+            if (d.kinds == 0) {
+                return 1;
             }
+            i += 2;
+        } else if (strcmp(argv[i], "-C") == 0) {
+            d.detect = 1;
+            i += 1;
+        } else {
+            break;
+        }
+    }
+
+    if (i < argc) {
+        for (; i < argc; i += 1) {
+            failed |= run_file(&d, argv[i]);
         }
     } else {
-        run(&s, stdin, "-", buf, sizeof(buf)/sizeof(buf[0]), out);
+        failed |= run_file(&d, "-");
     }
-    return 0;
+    if (profile) {
+        prof_report();
+    }
+    return failed;
 }
 #endif /* _HASHI_SHA1_EXE_ */
 #endif /* HASHI_SHA1_EXE */
@@ -112,9 +780,11 @@ int main(const int argc, const char *argv[]) {
 /* Resources:
  * - https://en.wikipedia.org/wiki/SHA-1
  * - zig std 0.11.0: lib/std/crypto/sha1.zig
+ * - RFC 2104 (HMAC), RFC 8018 (PBKDF2)
  */
 
 #include <assert.h>
+#include <stddef.h>
 
 void sha1_hash(const uint8_t data[], uint64_t size, uint8_t out[SHA1_DIGEST_LEN]) {
     Sha1State s;
@@ -132,96 +802,438 @@ void sha1_init(Sha1State *s) {
     s->size = 0;
 }
 
+#define SHA1_STEPS 80
+
+/* Compresses `chunk` into `s`, expanding the message into `w`.
+ * For collision detection, also keeps the states {a, b, c, d, e}
+ * before steps 58 and 65 (when `q58` and `q65` are not NULL).
+ */
 static inline
-void sha1__round(uint32_t s[SHA1_S_LEN], const uint8_t chunk[SHA1_CHUNK_LEN]) {
-    #define SHA1_ROUND_INDEX(i) ((i) & ((SHA1_CHUNK_LEN/4) - 1))
+void sha1__round_ex(
+    uint32_t s[SHA1_S_LEN], const uint8_t chunk[SHA1_CHUNK_LEN],
+    uint32_t w[SHA1_STEPS], uint32_t *q58, uint32_t *q65
+) {
     #define SHA1_ROTL_32(x, i) ((((x) & ((1U << (32-(i))) - 1)) << (i)) | (((x) >> (32-(i))) & ((1U << (i)) - 1)))
 
-    uint32_t ns[SHA1_S_LEN];
-    uint32_t w[SHA1_CHUNK_LEN/4];
-
-    for (uint8_t i = 0; i < SHA1_S_LEN; i += 1) {
-        ns[i] = s[i];
-    }
-
-    for (uint8_t i = 0; i < SHA1_CHUNK_LEN/4; i += 1) {
-        w[i] = 0;
+    for (uint8_t t = 0; t < SHA1_CHUNK_LEN/4; t += 1) {
+        w[t] = 0;
         for (uint8_t j = 0; j < 4; j += 1) {
-            w[i] |= chunk[(i*4) + j] << (8*(4-1-j));
+            w[t] |= (uint32_t) chunk[(t*4) + j] << (8*(4-1-j));
         }
     }
 
     {
-        #define SHA1_ROUND(len, k, in_f) do { \
-            for (; i < (len); i += 1) { \
-                const uint8_t e = (i+0) % SHA1_S_LEN; \
-                const uint8_t d = (i+1) % SHA1_S_LEN; \
-                const uint8_t c = (i+2) % SHA1_S_LEN; \
-                const uint8_t b = (i+3) % SHA1_S_LEN; \
-                const uint8_t a = (i+4) % SHA1_S_LEN; \
-                \
-                const uint32_t ra = SHA1_ROTL_32(ns[a], 5); \
-                const uint32_t f = (in_f); \
-                \
-                w[SHA1_ROUND_INDEX(i)] = SHA1_ROTL_32(w[SHA1_ROUND_INDEX(i-3)] ^ w[SHA1_ROUND_INDEX(i-8)] ^ w[SHA1_ROUND_INDEX(i-14)] ^ w[SHA1_ROUND_INDEX(i-16)], 1); \
-                ns[b] = SHA1_ROTL_32((ns[b]), 30); \
-                ns[e] = ra + f + ns[e] + (k) + w[SHA1_ROUND_INDEX(i)]; \
+        // Note: the message is expanded along the steps
+        #define SHA1_STEPS_UNTIL(len, k, in_f) do { \
+            for (; t < (len); t += 1) { \
+                if (SHA1_CHUNK_LEN/4 <= t) { \
+                    w[t] = SHA1_ROTL_32(w[t-3] ^ w[t-8] ^ w[t-14] ^ w[t-16], 1); \
+                } \
+                const uint32_t tmp = SHA1_ROTL_32(a, 5) + (in_f) + e + (k) + w[t]; \
+                e = d; \
+                d = c; \
+                c = SHA1_ROTL_32(b, 30); \
+                b = a; \
+                a = tmp; \
+            } \
+        } while(0)
+        #define SHA1_SAVE(q) do { \
+            if (q) { \
+                (q)[0] = a; (q)[1] = b; (q)[2] = c; (q)[3] = d; (q)[4] = e; \
             } \
         } while(0)
 
-        uint8_t i = 0;
-        for (; i < 16; i += 1) {
-            const uint8_t e = (i+0) % SHA1_S_LEN;
-            const uint8_t d = (i+1) % SHA1_S_LEN;
-            const uint8_t c = (i+2) % SHA1_S_LEN;
-            const uint8_t b = (i+3) % SHA1_S_LEN;
-            const uint8_t a = (i+4) % SHA1_S_LEN;
+        uint32_t a = s[4], b = s[3], c = s[2], d = s[1], e = s[0];
+        uint8_t t = 0;
+        SHA1_STEPS_UNTIL(SHA1_CHUNK_LEN/4, 0x5A827999, ((b & c) | ((~b) & d)));
+        SHA1_STEPS_UNTIL(20, 0x5A827999, ((b & c) | ((~b) & d)));
+        SHA1_STEPS_UNTIL(40, 0x6ED9EBA1, (b ^ c ^ d));
+        SHA1_STEPS_UNTIL(58, 0x8F1BBCDC, ((b & c) | (b & d) | (c & d)));
+        SHA1_SAVE(q58);
+        SHA1_STEPS_UNTIL(60, 0x8F1BBCDC, ((b & c) | (b & d) | (c & d)));
+        SHA1_STEPS_UNTIL(65, 0xCA62C1D6, (b ^ c ^ d));
+        SHA1_SAVE(q65);
+        SHA1_STEPS_UNTIL(80, 0xCA62C1D6, (b ^ c ^ d));
 
-            const uint32_t ra = SHA1_ROTL_32(ns[a], 5);
-            const uint32_t f = ((ns[b] & ns[c]) | ((~ns[b]) & ns[d]));
-            const uint32_t k = 0x5A827999;
+        s[4] += a;
+        s[3] += b;
+        s[2] += c;
+        s[1] += d;
+        s[0] += e;
+        #undef SHA1_SAVE
+        #undef SHA1_STEPS_UNTIL
+    }
+    #undef SHA1_ROTL_32
+}
 
-            ns[b] = SHA1_ROTL_32(ns[b], 30);
-            ns[e] = ra + f + ns[e] + k + w[i];
-        }
-        SHA1_ROUND(20, 0x5A827999, ((ns[b] & ns[c]) | ((~ns[b]) & ns[d])));
-        SHA1_ROUND(40, 0x6ED9EBA1, (ns[b] ^ ns[c] ^ ns[d]));
-        SHA1_ROUND(60, 0x8F1BBCDC, ((ns[b] & ns[c]) | (ns[b] & ns[d]) | (ns[c] & ns[d])));
-        SHA1_ROUND(80, 0xCA62C1D6, (ns[b] ^ ns[c] ^ ns[d]));
+static inline
+void sha1__round(uint32_t s[SHA1_S_LEN], const uint8_t chunk[SHA1_CHUNK_LEN]) {
+    uint32_t w[SHA1_STEPS];
+    sha1__round_ex(s, chunk, w, NULL, NULL);
+}
 
-        assert(i == 80);
-        #undef SHA1_ROUND
+/* Collision detection
+ *
+ * Resources:
+ * - M. Stevens, "Counter-cryptanalysis", CRYPTO 2013
+ * - M. Stevens, D. Shumow, "Speeding up detection of SHA-1 collision attacks
+ *   using unavoidable attack conditions", USENIX Security 2017
+ * - S. Manuel, "Classification and generation of disturbance vectors
+ *   for collision attacks against SHA-1", DCC 2011
+ * - M. Stevens et al., "The first collision for full SHA-1", CRYPTO 2017 (SHAttered)
+ *
+ * Known attacks build the block that completes the collision
+ * from one of the disturbance vectors (DVs) below. For such a chunk,
+ * xor-ing the message difference of the DV (`dm`) gives the partner chunk,
+ * whose internal state equals the one of the chunk at step `testt`.
+ * From the state at `testt`, the partner is computed backwards
+ * (chaining value it needs) and forwards (its output):
+ * if both chunks give the same output, it is a collision.
+ * Then, as the "safe hash" of SHA-1DC, the chunk is compressed twice more,
+ * so the colliding inputs get different digests.
+ *
+ * Recomputing the partner for all DVs costs as much as 32 chunks,
+ * so each DV is first filtered by message bit conditions
+ * that its local collisions need with overwhelming probability:
+ * a disturbance on bit `j` at step `t` and its corrections
+ * (bit j+5 at step t+1 and bit j+30 at step t+5) have opposite signs,
+ * for the disturbances of steps 20-74 that share no bit with another one
+ * (before that the attacks use a non-linear path).
+ * The conditions are ordered greedily by the expected number of DVs ruled out,
+ * and checked unrolled (`SHA1DC_CONDITIONS`).
+ * A chunk not built for an attack fails every DV after about 47 of them
+ * (and at least 12), while the last block of SHAttered
+ * passes all the ones of its DV, II(52,0).
+ */
+#define SHA1DC_STEPS SHA1_STEPS
+#define SHA1DC_DVS_LEN 32
+#define SHA1DC_PRE 5 /* DVs start from step -5 */
+
+typedef struct {
+    uint8_t type; /* Manuel's type I or II */
+    uint8_t k;
+    uint8_t b;
+    uint8_t testt;
+} Sha1DcDv;
+
+/* Note: same DVs as the reference implementation (sha1collisiondetection) */
+static const Sha1DcDv sha1dc__dvs[SHA1DC_DVS_LEN] = {
+    {1, 43, 0, 58}, {1, 44, 0, 58}, {1, 45, 0, 58}, {1, 46, 0, 58},
+    {1, 46, 2, 58}, {1, 47, 0, 58}, {1, 47, 2, 58}, {1, 48, 0, 58},
+    {1, 48, 2, 58}, {1, 49, 0, 58}, {1, 49, 2, 58}, {1, 50, 0, 65},
+    {1, 50, 2, 65}, {1, 51, 0, 65}, {1, 51, 2, 65}, {1, 52, 0, 65},
+    {2, 45, 0, 58}, {2, 46, 0, 58}, {2, 46, 2, 58}, {2, 47, 0, 58},
+    {2, 48, 0, 58}, {2, 49, 0, 58}, {2, 49, 2, 58}, {2, 50, 0, 65},
+    {2, 50, 2, 65}, {2, 51, 0, 65}, {2, 51, 2, 65}, {2, 52, 0, 65},
+    {2, 53, 0, 65}, {2, 54, 0, 65}, {2, 55, 0, 65}, {2, 56, 0, 65},
+};
+
+/* Note: computed once from `sha1dc__dvs` as described above
+ * (bench checks it against `sha1dc__dv`),
+ * `C(t, j, o, dvs)` rules out `dvs` when bit j of w[t] equals
+ * bit j+5 of w[t+1] (o = 1) or bit j+30 of w[t+5] (o = 5).
+ */
+#define SHA1DC_CONDITIONS(C) \
+    C(73, 3, 1, 0x05211202) C(74, 3, 1, 0x04834804) C(72, 3, 1, 0x01500481) \
+    C(22, 30, 1, 0x42002021) C(23, 30, 1, 0x88008082) C(69, 3, 1, 0x04054014) \
+    C(69, 1, 1, 0x020A2008) C(24, 1, 1, 0x01401050) C(21, 30, 1, 0x20800808) \
+    C(70, 1, 1, 0x08188020) C(20, 30, 1, 0x10200204) C(25, 1, 1, 0x05004140) \
+    C(23, 30, 5, 0x88008082) C(22, 30, 5, 0x42002021) C(21, 30, 5, 0x20800808) \
+    C(27, 1, 1, 0x00041400) C(20, 30, 5, 0x10200204) C(71, 3, 1, 0x00480120) \
+    C(71, 1, 1, 0x10300080) C(68, 1, 1, 0x00830804) C(32, 1, 1, 0x04001410) \
+    C(30, 1, 1, 0x00400140) C(74, 1, 1, 0x8A002000) C(69, 3, 5, 0x04044010) \
+    C(26, 30, 5, 0x40002021) C(72, 1, 1, 0x20A00200) C(27, 30, 5, 0x80008082) \
+    C(70, 3, 1, 0x00020048) C(71, 4, 5, 0x01041002) C(31, 1, 1, 0x01000500) \
+    C(73, 1, 1, 0x42800800) C(67, 0, 1, 0x08108000) C(24, 30, 1, 0x10000204) \
+    C(25, 30, 1, 0x20000808) C(68, 2, 1, 0x00480020) C(29, 1, 1, 0x00004050) \
+    C(26, 30, 1, 0x40002021) C(27, 30, 1, 0x80008082) C(26, 1, 1, 0x04000500) \
+    C(67, 1, 1, 0x00210202) C(36, 1, 1, 0x00041040) C(25, 30, 5, 0x20000808) \
+    C(66, 1, 1, 0x00100081) C(66, 0, 1, 0x02082000) C(23, 1, 1, 0x00400410) \
+    C(24, 30, 5, 0x10000204) C(65, 0, 1, 0x00820800) C(74, 3, 5, 0x04014004) \
+    C(67, 0, 5, 0x08108000) C(71, 4, 1, 0x01041002) C(68, 2, 5, 0x00480020) \
+    C(41, 1, 1, 0x04040100) C(61, 0, 1, 0x00020008) C(68, 0, 1, 0x10200000) \
+    C(70, 0, 1, 0x42000000) C(71, 0, 1, 0x88000000) C(64, 2, 5, 0x00400401) \
+    C(28, 1, 1, 0x00005010) C(69, 0, 1, 0x20800000) C(70, 2, 1, 0x04210200) \
+    C(40, 1, 1, 0x01004040) C(66, 0, 5, 0x02082000) C(73, 2, 1, 0x08108000) \
+    C(73, 4, 5, 0x00020008) C(20, 1, 1, 0x01040010) C(64, 2, 1, 0x00400401) \
+    C(34, 1, 1, 0x00004100) C(68, 0, 5, 0x10200000) C(69, 0, 5, 0x20800000) \
+    C(70, 0, 5, 0x42000000) C(71, 0, 5, 0x88000000) C(69, 2, 1, 0x01100080) \
+    C(72, 4, 1, 0x04014004) C(74, 4, 1, 0x00480020) C(65, 0, 5, 0x00820800) \
+    C(65, 2, 1, 0x01041002) C(33, 1, 1, 0x00005040) C(70, 2, 5, 0x04210200) \
+    C(72, 2, 1, 0x02082000) C(73, 2, 5, 0x08108000) C(67, 3, 1, 0x00400401) \
+    C(74, 2, 1, 0x10200000) C(37, 1, 1, 0x00004100) C(64, 1, 1, 0x00020008) \
+    C(41, 30, 1, 0x20000000) C(42, 30, 1, 0x40000000) C(43, 30, 1, 0x80000000) \
+    C(69, 2, 5, 0x01100080) C(21, 1, 1, 0x04040040) C(35, 1, 1, 0x00000410) \
+    C(71, 2, 1, 0x00820800) C(72, 2, 5, 0x02082000) C(64, 0, 1, 0x00210200) \
+    C(65, 2, 5, 0x01041002) C(74, 2, 5, 0x10200000) C(31, 30, 1, 0x00008080) \
+    C(22, 1, 1, 0x00000100) C(41, 30, 5, 0x20000000) C(42, 30, 5, 0x40000000) \
+    C(43, 30, 5, 0x80000000) C(70, 4, 1, 0x00400401) C(66, 2, 5, 0x04014004) \
+    C(74, 4, 5, 0x00480020) C(67, 2, 5, 0x00020008) C(21, 0, 5, 0x01001010) \
+    C(22, 0, 5, 0x04004040) C(30, 30, 5, 0x00002020) C(31, 30, 5, 0x00008080) \
+    C(28, 30, 5, 0x00000204) C(23, 0, 1, 0x00000100) C(71, 2, 5, 0x00820800) \
+    C(40, 30, 1, 0x10000000) C(73, 0, 1, 0x20000000) C(74, 0, 1, 0x40000000) \
+    C(68, 3, 1, 0x01041002) C(70, 4, 5, 0x00400401) C(63, 0, 1, 0x00100080) \
+    C(29, 30, 1, 0x00000808) C(67, 4, 5, 0x00040010) C(64, 0, 5, 0x00210200) \
+    C(22, 0, 1, 0x04004040) C(23, 0, 5, 0x00000100) C(65, 1, 1, 0x00080020) \
+    C(35, 30, 1, 0x00108000) C(39, 30, 1, 0x08000000) C(40, 30, 5, 0x10000000) \
+    C(73, 0, 5, 0x20000000) C(74, 0, 5, 0x40000000) C(73, 5, 1, 0x00400401) \
+    C(72, 4, 5, 0x04014004) C(74, 5, 1, 0x01041002) C(34, 30, 1, 0x00082000) \
+    C(61, 0, 5, 0x00020008) C(39, 1, 1, 0x00401010) C(26, 0, 5, 0x00004040) \
+    C(31, 0, 5, 0x00000100) C(35, 30, 5, 0x00108000) C(28, 30, 1, 0x00000204) \
+    C(38, 30, 1, 0x02000000) C(29, 30, 5, 0x00000808) C(39, 30, 5, 0x08000000) \
+    C(72, 0, 1, 0x10000000) C(30, 30, 1, 0x00002020) C(72, 3, 5, 0x00400401) \
+    C(63, 0, 5, 0x00100080) C(61, 2, 1, 0x00040010) C(73, 3, 5, 0x01001002) \
+    C(66, 2, 1, 0x04014004) C(26, 0, 1, 0x00004040) C(27, 0, 5, 0x00000100) \
+    C(33, 30, 1, 0x00020800) C(62, 0, 1, 0x00080020) C(37, 30, 1, 0x00800000) \
+    C(38, 30, 5, 0x02000000) C(72, 0, 5, 0x10000000) C(34, 30, 5, 0x00082000) \
+    C(73, 4, 1, 0x00020008) C(32, 30, 1, 0x00010200) C(64, 3, 1, 0x00040010) \
+    C(30, 0, 1, 0x00004040) C(59, 0, 5, 0x00000002) C(61, 1, 1, 0x00000001) \
+    C(71, 3, 5, 0x00000100) C(37, 30, 5, 0x00800000) C(33, 30, 5, 0x00020800) \
+    C(63, 1, 1, 0x00010004) C(62, 0, 5, 0x00080020) C(21, 0, 1, 0x01001010) \
+    C(67, 2, 1, 0x00020008) C(32, 30, 5, 0x00010200) C(20, 0, 1, 0x00400400) \
+    C(30, 0, 5, 0x00004040) C(27, 0, 1, 0x00000100) C(62, 1, 1, 0x00000002) \
+    C(36, 30, 1, 0x00200000) C(58, 0, 5, 0x00000001) C(61, 2, 5, 0x00040010) \
+    C(60, 0, 1, 0x00010004) C(67, 3, 5, 0x00400400) C(65, 3, 5, 0x00000040) \
+    C(69, 4, 5, 0x00000100) C(36, 30, 5, 0x00200000) C(58, 0, 1, 0x00000001) \
+    C(59, 0, 1, 0x00000002) C(64, 3, 5, 0x00040010) C(60, 0, 5, 0x00010004) \
+    C(20, 0, 5, 0x00400400) C(68, 4, 5, 0x00000040) C(31, 0, 1, 0x00000100) \
+    C(29, 0, 1, 0x00001010) C(68, 4, 1, 0x00000040) C(33, 0, 1, 0x00041000) \
+    C(28, 0, 5, 0x00000400) C(66, 3, 5, 0x00000100) C(67, 4, 1, 0x00040010) \
+    C(68, 3, 5, 0x01001000) C(70, 3, 5, 0x00000040) C(32, 0, 1, 0x00000400) \
+    C(38, 0, 1, 0x04000000) C(69, 4, 1, 0x00000100) C(25, 0, 1, 0x00001010) \
+    C(24, 0, 1, 0x00000400) C(37, 0, 1, 0x01000000) C(38, 0, 5, 0x04000000) \
+    C(63, 2, 1, 0x00000100) C(62, 2, 1, 0x00000040) C(73, 6, 5, 0x00040010) \
+    C(44, 1, 1, 0x00404000) C(37, 0, 5, 0x01000000) C(42, 1, 1, 0x00000400) \
+    C(33, 0, 5, 0x00041000) C(46, 1, 1, 0x04000000) C(72, 5, 1, 0x00000100) \
+    C(71, 5, 1, 0x00000040) C(25, 0, 5, 0x00001010) C(45, 1, 1, 0x01000000) \
+    C(50, 1, 1, 0x00400000) C(52, 1, 1, 0x04000000) C(24, 0, 5, 0x00000400) \
+    C(63, 2, 5, 0x00000100) C(62, 2, 5, 0x00000040) C(70, 5, 1, 0x00040010) \
+    C(51, 1, 1, 0x01000000) C(32, 0, 5, 0x00000400) C(36, 0, 5, 0x00400000) \
+    C(34, 0, 1, 0x00004000) C(29, 0, 5, 0x00001010) C(74, 6, 5, 0x00000040) \
+    C(66, 3, 1, 0x00000100) C(73, 6, 1, 0x00040010) C(34, 0, 5, 0x00004000) \
+    C(38, 1, 1, 0x00000400) C(36, 0, 1, 0x00400000) C(65, 3, 1, 0x00000040) \
+    C(47, 1, 1, 0x00040000) C(74, 6, 1, 0x00000040) C(43, 1, 1, 0x00001000) \
+    C(28, 0, 1, 0x00000400)
+
+static inline
+uint32_t sha1dc__rotl(uint32_t x, uint8_t i) {
+    i &= 31;
+    return i == 0 ? x : ((x << i) | (x >> (32 - i)));
+}
+
+/* Expands DV `i` (a valid expanded message, given by 16 consecutive words),
+ * from step -SHA1DC_PRE: step `t` is at index `t + SHA1DC_PRE`
+ */
+static
+void sha1dc__dv(uint8_t i, uint32_t dv[SHA1DC_PRE + SHA1DC_STEPS]) {
+    const Sha1DcDv d = sha1dc__dvs[i];
+    const uint8_t k = d.k + SHA1DC_PRE;
+
+    for (uint8_t x = 0; x < SHA1DC_PRE + SHA1DC_STEPS; x += 1) {
+        dv[x] = 0;
+    }
+    /* Note: type I has bit `b` at step K+15,
+     * type II has bit 31+b at steps K+1 and K+3, and bit b at step K+15
+     */
+    if (d.type == 1) {
+        dv[k + 15] = sha1dc__rotl(1, d.b);
+    } else {
+        dv[k + 1] = sha1dc__rotl(1U << 31, d.b);
+        dv[k + 3] = sha1dc__rotl(1U << 31, d.b);
+        dv[k + 15] = sha1dc__rotl(1, d.b);
     }
+    for (uint8_t x = k + 16; x < SHA1DC_PRE + SHA1DC_STEPS; x += 1) {
+        dv[x] = sha1dc__rotl(dv[x-3] ^ dv[x-8] ^ dv[x-14] ^ dv[x-16], 1);
+    }
+    for (uint8_t x = k; 0 < x; x -= 1) {
+        dv[x-1] = sha1dc__rotl(dv[x+15], 31) ^ dv[x+12] ^ dv[x+7] ^ dv[x+1];
+    }
+}
 
-    for (uint8_t i = 0; i < SHA1_S_LEN; i += 1) {
-        s[i] += ns[i];
+// Note: message difference of DV `i`
+static
+void sha1dc__dm(uint8_t i, uint32_t dm[SHA1DC_STEPS]) {
+    uint32_t dv[SHA1DC_PRE + SHA1DC_STEPS];
+    sha1dc__dv(i, dv);
+
+    /* Local collision: disturbance on bit `j` at step `t`,
+     * corrections on bits j+5, j, j+30, j+30, j+30 of the next 5 steps.
+     */
+    for (uint8_t x = SHA1DC_PRE; x < SHA1DC_PRE + SHA1DC_STEPS; x += 1) {
+        dm[x - SHA1DC_PRE] = dv[x] ^ sha1dc__rotl(dv[x-1], 5) ^ dv[x-2]
+            ^ sha1dc__rotl(dv[x-3] ^ dv[x-4] ^ dv[x-5], 30);
     }
-    #undef SHA1_ROTL_32
-    #undef SHA1_ROUND_INDEX
 }
 
-void sha1_update(Sha1State *s, const uint8_t data[], uint64_t size) {
-    uint64_t i = 0;
+static inline
+uint32_t sha1dc__f(uint8_t t, uint32_t b, uint32_t c, uint32_t d) {
+    if (t < 20) {
+        return (b & c) | ((~b) & d);
+    } else if (t < 40) {
+        return b ^ c ^ d;
+    } else if (t < 60) {
+        return (b & c) | (b & d) | (c & d);
+    } else {
+        return b ^ c ^ d;
+    }
+}
+
+static inline
+uint32_t sha1dc__k(uint8_t t) {
+    static const uint32_t k[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+    return k[t / 20];
+}
+
+/* `q` is {a, b, c, d, e} before step `t` */
+static inline
+void sha1dc__step(uint32_t q[SHA1_S_LEN], uint8_t t, uint32_t w) {
+    const uint32_t tmp = sha1dc__rotl(q[0], 5) + sha1dc__f(t, q[1], q[2], q[3]) + q[4] + sha1dc__k(t) + w;
+    q[4] = q[3];
+    q[3] = q[2];
+    q[2] = sha1dc__rotl(q[1], 30);
+    q[1] = q[0];
+    q[0] = tmp;
+}
+
+/* `q` is {a, b, c, d, e} after step `t` */
+static inline
+void sha1dc__unstep(uint32_t q[SHA1_S_LEN], uint8_t t, uint32_t w) {
+    const uint32_t a = q[1];
+    const uint32_t b = sha1dc__rotl(q[2], 2);
+    const uint32_t c = q[3];
+    const uint32_t d = q[4];
+    q[4] = q[0] - sha1dc__rotl(a, 5) - sha1dc__f(t, b, c, d) - sha1dc__k(t) - w;
+    q[3] = d;
+    q[2] = c;
+    q[1] = b;
+    q[0] = a;
+}
+
+/* Returns 1 when the partner chunk of DV `i` collides with `w` */
+static
+uint8_t sha1dc__recompress(uint8_t i, const uint32_t w[SHA1DC_STEPS], const uint32_t q_testt[SHA1_S_LEN], const uint32_t out[SHA1_S_LEN]) {
+    const uint8_t testt = sha1dc__dvs[i].testt;
+    uint32_t w2[SHA1DC_STEPS];
+    uint32_t ihv2[SHA1_S_LEN];
+    uint32_t q[SHA1_S_LEN];
+    uint8_t same = 1;
+
+    sha1dc__dm(i, w2);
+    for (uint8_t t = 0; t < SHA1DC_STEPS; t += 1) {
+        w2[t] ^= w[t];
+    }
+
+    for (uint8_t j = 0; j < SHA1_S_LEN; j += 1) {
+        ihv2[j] = q_testt[j];
+    }
+    for (uint8_t t = testt; 0 < t; t -= 1) {
+        sha1dc__unstep(ihv2, t - 1, w2[t - 1]);
+    }
+
+    for (uint8_t j = 0; j < SHA1_S_LEN; j += 1) {
+        q[j] = q_testt[j];
+    }
+    for (uint8_t t = testt; t < SHA1DC_STEPS; t += 1) {
+        sha1dc__step(q, t, w2[t]);
+    }
+
+    for (uint8_t j = 0; j < SHA1_S_LEN; j += 1) {
+        same &= (ihv2[j] + q[j]) == out[j];
+    }
+    return same;
+}
+
+/* Same as `sha1__round`, returns 1 when the chunk completes a collision
+ * (and then `s` gets the safe hash)
+ */
+static inline
+uint8_t sha1dc__round(uint32_t s[SHA1_S_LEN], const uint8_t chunk[SHA1_CHUNK_LEN]) {
+    uint32_t w[SHA1DC_STEPS];
+    uint32_t q58[SHA1_S_LEN];
+    uint32_t q65[SHA1_S_LEN];
+    uint32_t out[SHA1_S_LEN];
+    uint32_t dvs = 0xFFFFFFFF;
+    uint8_t collision = 0;
+
+    sha1__round_ex(s, chunk, w, q58, q65);
+    for (uint8_t j = 0; j < SHA1_S_LEN; j += 1) {
+        out[j] = s[SHA1_S_LEN-1-j];
+    }
+
+    // Note: branchless, but for leaving once every DV is ruled out
+    #define SHA1DC_CHECK(t, j, o, ruled_out) \
+        if (dvs != 0) { \
+            const uint32_t x = w[t] ^ sha1dc__rotl(w[(t) + (o)], (o) == 1 ? 32 - 5 : 32 - 30); \
+            dvs &= ~(uint32_t) (ruled_out) | (0U - ((x >> (j)) & 1)); \
+        }
+    SHA1DC_CONDITIONS(SHA1DC_CHECK)
+    #undef SHA1DC_CHECK
 
-    if (0 < SHA1_CHUNK_INDEX(s->size) && SHA1_CHUNK_LEN <= SHA1_CHUNK_INDEX(s->size) + size) {
-        for (; SHA1_CHUNK_INDEX(s->size) + i < SHA1_CHUNK_LEN; i += 1) {
-            s->buf[SHA1_CHUNK_INDEX(s->size) + i] = data[i];
+    for (uint8_t i = 0; dvs != 0; i += 1, dvs >>= 1) {
+        if (dvs & 1) {
+            const uint32_t *q_testt = sha1dc__dvs[i].testt == 58 ? q58 : q65;
+            collision |= sha1dc__recompress(i, w, q_testt, out);
         }
-        sha1__round(s->s, s->buf);
     }
 
-    for (; i + SHA1_CHUNK_LEN <= size; i += SHA1_CHUNK_LEN) {
-        sha1__round(s->s, data + i);
+    if (collision) {
+        sha1__round(s, chunk);
+        sha1__round(s, chunk);
     }
+    return collision;
+}
 
-    for (uint8_t j = 0; i + j < size; j += 1) {
-        s->buf[j] = data[i + j];
+/* Plain round when `collision` is NULL, detecting round otherwise */
+static inline
+void sha1__compress(uint32_t s[SHA1_S_LEN], const uint8_t chunk[SHA1_CHUNK_LEN], uint8_t *collision) {
+    if (collision) {
+        *collision |= sha1dc__round(s, chunk);
+    } else {
+        sha1__round(s, chunk);
     }
+}
+
+static inline
+void sha1__digest(const uint32_t s[SHA1_S_LEN], uint8_t out[SHA1_DIGEST_LEN]) {
+    for (uint8_t i = 0; i < SHA1_S_LEN; i += 1) {
+        const uint8_t idx = 4*(SHA1_S_LEN-1-i);
+        for (uint8_t j = 0; j < 4; j += 1) {
+            out[idx + j] = (s[i] >> (8*(4-1-j))) & 0xFF;
+        }
+    }
+}
+
+static inline
+void sha1__update(Sha1State *s, const uint8_t data[], uint64_t size, uint8_t *collision) {
+    const uint8_t index = SHA1_CHUNK_INDEX(s->size);
+    uint8_t offset = index;
 
     s->size += size;
+    if (0 < index && (uint64_t) (SHA1_CHUNK_LEN - index) <= size) {
+        const uint8_t fill = (uint8_t) (SHA1_CHUNK_LEN - index);
+        for (uint8_t j = 0; j < fill; j += 1) {
+            s->buf[index + j] = data[j];
+        }
+        sha1__compress(s->s, s->buf, collision);
+        data += fill;
+        size -= fill;
+        offset = 0;
+    }
+
+    for (; SHA1_CHUNK_LEN <= size; size -= SHA1_CHUNK_LEN) {
+        sha1__compress(s->s, data, collision);
+        data += SHA1_CHUNK_LEN;
+        offset = 0;
+    }
+
+    // Note: `offset` keeps appending to a partial chunk when nothing was consumed
+    for (uint8_t j = 0; j < size; j += 1) {
+        s->buf[offset + j] = data[j];
+    }
 }
 
-void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]) {
+static inline
+void sha1__finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN], uint8_t *collision) {
     assert(SHA1_CHUNK_INDEX(s->size) < SHA1_CHUNK_LEN);
     s->buf[SHA1_CHUNK_INDEX(s->size)] = 0x80;
 
@@ -230,7 +1242,7 @@ void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]) {
     }
 
     if (SHA1_CHUNK_LEN - 9 < SHA1_CHUNK_INDEX(s->size)) {
-        sha1__round(s->s, s->buf);
+        sha1__compress(s->s, s->buf, collision);
         for (uint8_t i = 0; i < SHA1_CHUNK_INDEX(s->size) + 1; i += 1) {
             s->buf[i] = 0;
         }
@@ -243,16 +1255,172 @@ void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]) {
         }
     }
 
-    sha1__round(s->s, s->buf);
+    sha1__compress(s->s, s->buf, collision);
+
+    sha1__digest(s->s, out);
+}
+
+void sha1_update(Sha1State *s, const uint8_t data[], uint64_t size) {
+    sha1__update(s, data, size, NULL);
+}
+
+void sha1_finish(Sha1State *s, uint8_t out[SHA1_DIGEST_LEN]) {
+    sha1__finish(s, out, NULL);
+}
+
+uint8_t sha1dc_hash(const uint8_t data[], uint64_t size, uint8_t out[SHA1_DIGEST_LEN]) {
+    Sha1DcState s;
+    sha1dc_init(&s);
+    sha1dc_update(&s, data, size);
+    return sha1dc_finish(&s, out);
+}
+
+void sha1dc_init(Sha1DcState *s) {
+    sha1_init(&s->s);
+    s->collision = 0;
+}
+
+void sha1dc_update(Sha1DcState *s, const uint8_t data[], uint64_t size) {
+    sha1__update(&s->s, data, size, &s->collision);
+}
+
+uint8_t sha1dc_finish(Sha1DcState *s, uint8_t out[SHA1_DIGEST_LEN]) {
+    sha1__finish(&s->s, out, &s->collision);
+    return s->collision;
+}
+
+#define SHA1_HMAC_IPAD 0x36
+#define SHA1_HMAC_OPAD 0x5C
+
+void sha1_hmac_key(Sha1HmacKey *k, const uint8_t key[], uint64_t key_size) {
+    uint8_t key_block[SHA1_CHUNK_LEN] = {0};
+    uint8_t pad[SHA1_CHUNK_LEN];
+
+    if (SHA1_CHUNK_LEN < key_size) {
+        sha1_hash(key, key_size, key_block);
+    } else {
+        for (uint8_t i = 0; i < key_size; i += 1) {
+            key_block[i] = key[i];
+        }
+    }
+
+    for (uint8_t i = 0; i < SHA1_CHUNK_LEN; i += 1) {
+        pad[i] = key_block[i] ^ SHA1_HMAC_IPAD;
+    }
+    sha1_init(&k->inner);
+    sha1_update(&k->inner, pad, SHA1_CHUNK_LEN);
+
+    for (uint8_t i = 0; i < SHA1_CHUNK_LEN; i += 1) {
+        pad[i] = key_block[i] ^ SHA1_HMAC_OPAD;
+    }
+    sha1_init(&k->outer);
+    sha1_update(&k->outer, pad, SHA1_CHUNK_LEN);
+}
+
+void sha1_hmac_init(Sha1State *s, const Sha1HmacKey *k) {
+    *s = k->inner;
+}
+
+void sha1_hmac_finish(Sha1State *s, const Sha1HmacKey *k, uint8_t out[SHA1_DIGEST_LEN]) {
+    uint8_t inner[SHA1_DIGEST_LEN];
+    sha1_finish(s, inner);
+
+    *s = k->outer;
+    sha1_update(s, inner, SHA1_DIGEST_LEN);
+    sha1_finish(s, out);
+}
+
+void sha1_hmac(const Sha1HmacKey *k, const uint8_t data[], uint64_t size, uint8_t out[SHA1_DIGEST_LEN]) {
+    Sha1State s;
+    sha1_hmac_init(&s, k);
+    sha1_update(&s, data, size);
+    sha1_hmac_finish(&s, k, out);
+}
+
+/* Both the inner and the outer hash of an HMAC over a digest
+ * see exactly one pad block followed by `SHA1_DIGEST_LEN` bytes,
+ * so they share the same (already padded) last chunk.
+ * `block` holds the message in its first `SHA1_DIGEST_LEN` bytes
+ * and gets the HMAC written over it.
+ */
+static inline
+void sha1__hmac_digest_block(const Sha1HmacKey *k, uint8_t block[SHA1_CHUNK_LEN]) {
+    uint32_t s[SHA1_S_LEN];
 
     for (uint8_t i = 0; i < SHA1_S_LEN; i += 1) {
-        const uint8_t idx = 4*(SHA1_S_LEN-1-i);
-        for (uint8_t j = 0; j < 4; j += 1) {
-            out[idx + j] = (s->s[i] >> (8*(4-1-j))) & 0xFF;
+        s[i] = k->inner.s[i];
+    }
+    sha1__round(s, block);
+    sha1__digest(s, block);
+
+    for (uint8_t i = 0; i < SHA1_S_LEN; i += 1) {
+        s[i] = k->outer.s[i];
+    }
+    sha1__round(s, block);
+    sha1__digest(s, block);
+}
+
+uint8_t sha1_pbkdf2(
+    const uint8_t password[], uint64_t password_size,
+    const uint8_t salt[], uint64_t salt_size,
+    uint32_t iterations,
+    uint8_t out[], uint64_t out_size
+) {
+    Sha1HmacKey k;
+    uint8_t block[SHA1_CHUNK_LEN] = {0};
+
+    assert(0 < iterations);
+    // Note: "derived key too long", the block counter would wrap
+    if (SHA1_PBKDF2_MAX_LEN < out_size) {
+        return 1;
+    }
+    sha1_hmac_key(&k, password, password_size);
+
+    block[SHA1_DIGEST_LEN] = 0x80;
+    {
+        const uint64_t size = (SHA1_CHUNK_LEN + SHA1_DIGEST_LEN) << 3;
+        for (uint8_t i = 0; i < 8; i += 1) {
+            block[SHA1_CHUNK_LEN - 1 - i] = (size >> (8*i)) & 0xFF;
+        }
+    }
+
+    for (uint32_t b = 1; 0 < out_size; b += 1) {
+        uint8_t t[SHA1_DIGEST_LEN];
+
+        {
+            Sha1State s;
+            const uint8_t be_b[4] = {
+                (b >> 24) & 0xFF, (b >> 16) & 0xFF,
+                (b >> 8) & 0xFF, (b >> 0) & 0xFF,
+            };
+            sha1_hmac_init(&s, &k);
+            sha1_update(&s, salt, salt_size);
+            sha1_update(&s, be_b, sizeof(be_b));
+            sha1_hmac_finish(&s, &k, block);
+        }
+
+        for (uint8_t i = 0; i < SHA1_DIGEST_LEN; i += 1) {
+            t[i] = block[i];
+        }
+        for (uint32_t it = 1; it < iterations; it += 1) {
+            sha1__hmac_digest_block(&k, block);
+            for (uint8_t i = 0; i < SHA1_DIGEST_LEN; i += 1) {
+                t[i] ^= block[i];
+            }
+        }
+
+        for (uint8_t i = 0; i < SHA1_DIGEST_LEN && 0 < out_size; i += 1) {
+            *out = t[i];
+            out += 1;
+            out_size -= 1;
         }
     }
+    return 0;
 }
 
+#undef SHA1_HMAC_IPAD
+#undef SHA1_HMAC_OPAD
+
 #endif /* _HASHI_SHA1_IMPL_ */
 #endif /* HASHI_SHA1_IMPLEMENTATION */
 
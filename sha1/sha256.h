@@ -0,0 +1,209 @@
+/* sha256
+ *
+ * A library of sha256 hashing algorithm,
+ * companion of `sha1.h` with the same interface.
+ * To get the implementation of the functions,
+ * define `HASHI_SHA256_IMPLEMENTATION` before including this file.
+ *
+ * Copyright (C) 2026 Daniel K Hashimoto
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef _HASHI_SHA256_H_
+#define _HASHI_SHA256_H_
+
+#include <stdint.h>
+
+#define SHA256_CHUNK_LEN 64
+#define SHA256_CHUNK_INDEX_MASK (SHA256_CHUNK_LEN - 1)
+#define SHA256_CHUNK_INDEX(x) ((x) & SHA256_CHUNK_INDEX_MASK)
+
+#define SHA256_DIGEST_LEN 32
+
+#define SHA256_S_LEN 8
+
+typedef struct {
+    uint8_t buf[SHA256_CHUNK_LEN];
+    uint32_t s[SHA256_S_LEN];
+    uint64_t size;
+} Sha256State;
+
+void sha256_hash(const uint8_t data[], uint64_t size, uint8_t out[SHA256_DIGEST_LEN]);
+
+void sha256_init(Sha256State *s);
+
+void sha256_update(Sha256State *s, const uint8_t data[], uint64_t size);
+void sha256_finish(Sha256State *s, uint8_t out[SHA256_DIGEST_LEN]);
+
+#endif /* _HASHI_SHA256_H_ */
+
+#ifdef HASHI_SHA256_IMPLEMENTATION
+#ifndef _HASHI_SHA256_IMPL_
+#define _HASHI_SHA256_IMPL_
+
+/* Resources:
+ * - https://en.wikipedia.org/wiki/SHA-2
+ * - FIPS 180-4
+ */
+
+#include <assert.h>
+
+void sha256_hash(const uint8_t data[], uint64_t size, uint8_t out[SHA256_DIGEST_LEN]) {
+    Sha256State s;
+    sha256_init(&s);
+    sha256_update(&s, data, size);
+    sha256_finish(&s, out);
+}
+
+void sha256_init(Sha256State *s) {
+    s->s[0] = 0x6A09E667; /* a */
+    s->s[1] = 0xBB67AE85; /* b */
+    s->s[2] = 0x3C6EF372; /* c */
+    s->s[3] = 0xA54FF53A; /* d */
+    s->s[4] = 0x510E527F; /* e */
+    s->s[5] = 0x9B05688C; /* f */
+    s->s[6] = 0x1F83D9AB; /* g */
+    s->s[7] = 0x5BE0CD19; /* h */
+    s->size = 0;
+}
+
+static inline
+void sha256__round(uint32_t s[SHA256_S_LEN], const uint8_t chunk[SHA256_CHUNK_LEN]) {
+    #define SHA256_ROUND_INDEX(i) ((i) & ((SHA256_CHUNK_LEN/4) - 1))
+    #define SHA256_ROTR_32(x, i) (((x) >> (i)) | ((x) << (32-(i))))
+
+    static const uint32_t k[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+    };
+
+    uint32_t ns[SHA256_S_LEN];
+    uint32_t w[SHA256_CHUNK_LEN/4];
+
+    for (uint8_t i = 0; i < SHA256_S_LEN; i += 1) {
+        ns[i] = s[i];
+    }
+
+    for (uint8_t i = 0; i < SHA256_CHUNK_LEN/4; i += 1) {
+        w[i] = 0;
+        for (uint8_t j = 0; j < 4; j += 1) {
+            w[i] |= ((uint32_t) chunk[(i*4) + j]) << (8*(4-1-j));
+        }
+    }
+
+    for (uint8_t i = 0; i < 64; i += 1) {
+        /* Note: the working variables rotate through `ns`,
+         * `a` is ns[(-i) mod 8], `b` is ns[(1-i) mod 8], and so on.
+         */
+        const uint8_t a = (8 - (i & 7) + 0) & 7;
+        const uint8_t b = (8 - (i & 7) + 1) & 7;
+        const uint8_t c = (8 - (i & 7) + 2) & 7;
+        const uint8_t d = (8 - (i & 7) + 3) & 7;
+        const uint8_t e = (8 - (i & 7) + 4) & 7;
+        const uint8_t f = (8 - (i & 7) + 5) & 7;
+        const uint8_t g = (8 - (i & 7) + 6) & 7;
+        const uint8_t h = (8 - (i & 7) + 7) & 7;
+
+        if (16 <= i) {
+            const uint32_t w15 = w[SHA256_ROUND_INDEX(i-15)];
+            const uint32_t w2 = w[SHA256_ROUND_INDEX(i-2)];
+            const uint32_t s0 = SHA256_ROTR_32(w15, 7) ^ SHA256_ROTR_32(w15, 18) ^ (w15 >> 3);
+            const uint32_t s1 = SHA256_ROTR_32(w2, 17) ^ SHA256_ROTR_32(w2, 19) ^ (w2 >> 10);
+            w[SHA256_ROUND_INDEX(i)] += s0 + w[SHA256_ROUND_INDEX(i-7)] + s1;
+        }
+
+        {
+            const uint32_t s1 = SHA256_ROTR_32(ns[e], 6) ^ SHA256_ROTR_32(ns[e], 11) ^ SHA256_ROTR_32(ns[e], 25);
+            const uint32_t ch = (ns[e] & ns[f]) ^ ((~ns[e]) & ns[g]);
+            const uint32_t t1 = ns[h] + s1 + ch + k[i] + w[SHA256_ROUND_INDEX(i)];
+            const uint32_t s0 = SHA256_ROTR_32(ns[a], 2) ^ SHA256_ROTR_32(ns[a], 13) ^ SHA256_ROTR_32(ns[a], 22);
+            const uint32_t maj = (ns[a] & ns[b]) ^ (ns[a] & ns[c]) ^ (ns[b] & ns[c]);
+
+            ns[d] += t1;
+            /* Note: `h` becomes the next `a` */
+            ns[h] = t1 + s0 + maj;
+        }
+    }
+
+    for (uint8_t i = 0; i < SHA256_S_LEN; i += 1) {
+        s[i] += ns[i];
+    }
+    #undef SHA256_ROTR_32
+    #undef SHA256_ROUND_INDEX
+}
+
+void sha256_update(Sha256State *s, const uint8_t data[], uint64_t size) {
+    uint64_t i = 0;
+
+    if (0 < SHA256_CHUNK_INDEX(s->size) && SHA256_CHUNK_LEN <= SHA256_CHUNK_INDEX(s->size) + size) {
+        for (; SHA256_CHUNK_INDEX(s->size) + i < SHA256_CHUNK_LEN; i += 1) {
+            s->buf[SHA256_CHUNK_INDEX(s->size) + i] = data[i];
+        }
+        sha256__round(s->s, s->buf);
+    }
+
+    for (; i + SHA256_CHUNK_LEN <= size; i += SHA256_CHUNK_LEN) {
+        sha256__round(s->s, data + i);
+    }
+
+    {
+        // Note: keep appending to a partial chunk when nothing was consumed
+        const uint8_t offset = (i == 0) ? SHA256_CHUNK_INDEX(s->size) : 0;
+        for (uint8_t j = 0; i + j < size; j += 1) {
+            s->buf[offset + j] = data[i + j];
+        }
+    }
+
+    s->size += size;
+}
+
+void sha256_finish(Sha256State *s, uint8_t out[SHA256_DIGEST_LEN]) {
+    assert(SHA256_CHUNK_INDEX(s->size) < SHA256_CHUNK_LEN);
+    s->buf[SHA256_CHUNK_INDEX(s->size)] = 0x80;
+
+    for (uint8_t i = SHA256_CHUNK_INDEX(s->size) + 1; i < SHA256_CHUNK_LEN; i += 1) {
+        s->buf[i] = 0;
+    }
+
+    if (SHA256_CHUNK_LEN - 9 < SHA256_CHUNK_INDEX(s->size)) {
+        sha256__round(s->s, s->buf);
+        for (uint8_t i = 0; i < SHA256_CHUNK_INDEX(s->size) + 1; i += 1) {
+            s->buf[i] = 0;
+        }
+    }
+
+    {
+        uint64_t size = (s->size) << 3;
+        for (uint8_t i = 0; i < 8; i += 1) {
+            s->buf[SHA256_CHUNK_LEN - 1 - i] = (size >> (8*i)) & 0xFF;
+        }
+    }
+
+    sha256__round(s->s, s->buf);
+
+    for (uint8_t i = 0; i < SHA256_S_LEN; i += 1) {
+        for (uint8_t j = 0; j < 4; j += 1) {
+            out[4*i + j] = (s->s[i] >> (8*(4-1-j))) & 0xFF;
+        }
+    }
+}
+
+#endif /* _HASHI_SHA256_IMPL_ */
+#endif /* HASHI_SHA256_IMPLEMENTATION */
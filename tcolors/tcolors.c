@@ -1,8 +1,10 @@
 /* tcolors (terminal colors)
  *
  * Shows ANSI terminal colors.
- * Pallets 0-7 (dull and vivid) and 8 bit mode.
- * (Note: Missing 24-bit colors)
+ * Pallets 0-7 (dull and vivid), 8 bit mode
+ * and 24-bit (truecolor) gradients and palette.
+ * The whole frame is built in one buffer and written at once,
+ * sending only the attributes that change (see `sgr`).
  *
  * Copyright (C) 2024, 2026 Daniel K Hashimoto
  *
@@ -21,63 +23,279 @@
  */
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
 typedef unsigned char byte;
 
+#define FRAME_BUF_LEN 0x40000
+#define TEXT_MAX_LEN 0x80
+// Note: the longest SGR is "ESC[38;2;255;255;255;48;2;255;255;255m" (36 bytes)
+#define SGR_COLOR_MAX_LEN (sizeof("38;2;255;255;255") - 1)
+#define SGR_MAX_LEN (sizeof("\x1b[;m") - 1 + 2 * SGR_COLOR_MAX_LEN)
+
+static struct {
+    char buf[FRAME_BUF_LEN];
+    size_t len;
+} frame;
+
+void frame_flush(void) {
+    size_t done = 0;
+    while (done < frame.len) {
+        const size_t n = fwrite(frame.buf + done, sizeof(frame.buf[0]), frame.len - done, stdout);
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    frame.len = 0;
+}
+
+static inline
+void frame_reserve(const size_t len) {
+    if (FRAME_BUF_LEN - frame.len < len) {
+        frame_flush();
+    }
+}
+
+#define frame_text(...) do { \
+    frame_reserve(TEXT_MAX_LEN); \
+    const int text_len = snprintf(frame.buf + frame.len, TEXT_MAX_LEN, __VA_ARGS__); \
+    frame.len += (size_t) text_len; \
+} while(0)
+
+static inline
+void frame_num(const byte n) {
+    if (n >= 100) {
+        frame.buf[frame.len++] = (char) ('0' + n / 100);
+    }
+    if (n >= 10) {
+        frame.buf[frame.len++] = (char) ('0' + (n / 10) % 10);
+    }
+    frame.buf[frame.len++] = (char) ('0' + n % 10);
+}
+
+typedef enum {
+    COLOR_DEFAULT = 0,
+    COLOR_DULL,  // 30-37, 40-47
+    COLOR_VIVID, // 90-97, 100-107
+    COLOR_8BIT,  // 38;5;n, 48;5;n
+    COLOR_24BIT, // 38;2;r;g;b, 48;2;r;g;b
+} ColorKind;
+
+// Note: dull, vivid and 8-bit colors only use `r` (as the index)
+typedef struct {
+    ColorKind kind;
+    byte r;
+    byte g;
+    byte b;
+} Color;
+
+#define DEFAULT ((Color){ .kind = COLOR_DEFAULT, .r = 0, .g = 0, .b = 0 })
+#define DULL(i) ((Color){ .kind = COLOR_DULL, .r = (i), .g = 0, .b = 0 })
+#define VIVID(i) ((Color){ .kind = COLOR_VIVID, .r = (i), .g = 0, .b = 0 })
+#define BIT8(i) ((Color){ .kind = COLOR_8BIT, .r = (i), .g = 0, .b = 0 })
+#define RGB(x, y, z) ((Color){ .kind = COLOR_24BIT, .r = (x), .g = (y), .b = (z) })
+
+#define BLACK DULL(0)
+#define WHITE DULL(7)
+
+bool color_eq(const Color x, const Color y) {
+    return x.kind == y.kind && x.r == y.r && x.g == y.g && x.b == y.b;
+}
+
+/* SGR state tracker
+ *
+ * `term` is what the terminal is using, `sgr` sends one sequence
+ * with only the colors that differ from it (or "0", when it is shorter).
+ */
+static struct {
+    Color fg;
+    Color bg;
+} term;
+
+// Note: `base` is 30 for foreground and 40 for background
+void sgr_color(const Color c, const byte base) {
+    switch (c.kind) {
+        case COLOR_DEFAULT:
+            frame_num(base + 9);
+            break;
+        case COLOR_DULL:
+            frame_num(base + c.r);
+            break;
+        case COLOR_VIVID:
+            frame_num(base + 60 + c.r);
+            break;
+        case COLOR_8BIT:
+            frame_num(base + 8);
+            frame.buf[frame.len++] = ';';
+            frame.buf[frame.len++] = '5';
+            frame.buf[frame.len++] = ';';
+            frame_num(c.r);
+            break;
+        case COLOR_24BIT:
+            frame_num(base + 8);
+            frame.buf[frame.len++] = ';';
+            frame.buf[frame.len++] = '2';
+            frame.buf[frame.len++] = ';';
+            frame_num(c.r);
+            frame.buf[frame.len++] = ';';
+            frame_num(c.g);
+            frame.buf[frame.len++] = ';';
+            frame_num(c.b);
+            break;
+    }
+}
+
+void sgr(const Color fg, const Color bg) {
+    const bool fg_changed = !color_eq(fg, term.fg);
+    const bool bg_changed = !color_eq(bg, term.bg);
+
+    if (!fg_changed && !bg_changed) {
+        return;
+    }
+    frame_reserve(SGR_MAX_LEN);
+    frame.buf[frame.len++] = '\x1b';
+    frame.buf[frame.len++] = '[';
+    if (fg.kind == COLOR_DEFAULT && bg.kind == COLOR_DEFAULT && fg_changed && bg_changed) {
+        frame.buf[frame.len++] = '0';
+    } else {
+        if (fg_changed) {
+            sgr_color(fg, 30);
+        }
+        if (fg_changed && bg_changed) {
+            frame.buf[frame.len++] = ';';
+        }
+        if (bg_changed) {
+            sgr_color(bg, 40);
+        }
+    }
+    frame.buf[frame.len++] = 'm';
+    term.fg = fg;
+    term.bg = bg;
+}
+
+// Note: only the background matters for spaces
+void sgr_bg(const Color bg) {
+    sgr(term.fg, bg);
+}
+
+void newline(void) {
+    sgr_bg(DEFAULT);
+    frame_reserve(1);
+    frame.buf[frame.len++] = '\n';
+}
+
+/* Note: hue in [0, 6*0x100), saturation and value in [0, 0xFF] */
+Color hsv(const unsigned int hue, const byte sat, const byte val) {
+    const unsigned int f = hue & 0xFF;
+    const byte p = (byte) (val * (0xFF - sat) / 0xFF);
+    const byte q = (byte) (val * (0xFF - sat * f / 0xFF) / 0xFF);
+    const byte t = (byte) (val * (0xFF - sat * (0xFF - f) / 0xFF) / 0xFF);
+    switch (hue >> 8) {
+        case 0: return RGB(val, t, p);
+        case 1: return RGB(q, val, p);
+        case 2: return RGB(p, val, t);
+        case 3: return RGB(p, q, val);
+        case 4: return RGB(t, p, val);
+        default: return RGB(val, p, q);
+    }
+}
+
+#define GRADIENT_LEN 64
+
 void tcolors(void) {
+    term.fg = DEFAULT;
+    term.bg = DEFAULT;
     {
         // Terminal Colors
-        printf(" ======  ======  ======   4-bit  Colors  ======  ======  ======\n");
+        frame_text(" ======  ======  ======   4-bit  Colors  ======  ======  ======\n");
         for (byte i = 0; i < 8; i += 1) {
-            printf(
-                "\x1b[4%hhu;37m4%hhu  \x1b[30m  4%hhu",
-                i, i, i
-            );
+            sgr(WHITE, DULL(i));
+            frame_text("4%hhu  ", i);
+            sgr(BLACK, DULL(i));
+            frame_text("  4%hhu", i);
         }
-        printf("\x1b[0m\n");
+        sgr(DEFAULT, DEFAULT);
+        frame_text("\n");
         for (byte i = 0; i < 8; i += 1) {
-            printf(
-                "\x1b[10%hhu;37m10%hhu \x1b[30m 10%hhu",
-                i, i, i
-            );
+            sgr(WHITE, VIVID(i));
+            frame_text("10%hhu ", i);
+            sgr(BLACK, VIVID(i));
+            frame_text(" 10%hhu", i);
         }
     }
     {
         // 8-bit Colors
-        printf("\x1b[0m\n ======  ======  ======   8-bit  Colors  ======  ======  ======\n");
+        sgr(DEFAULT, DEFAULT);
+        frame_text("\n ======  ======  ======   8-bit  Colors  ======  ======  ======\n");
         byte i = 0;
         for (; i < 0x10; i += 1) {
-            printf(
-                "\x1b[48;5;%1hhu;37m%-4hhu\x1b[30m%4hhu",
-                i, i, i
-            );
+            sgr(WHITE, BIT8(i));
+            frame_text("%-4hhu", i);
+            sgr(BLACK, BIT8(i));
+            frame_text("%4hhu", i);
             if (((i+1) & 0x7) == 0) {
-                printf("\x1b[49m\n");
+                newline();
             }
         }
         for (; i < 0xE8; i += 1) {
-            printf(
-                "\x1b[48;5;%hhu;37m%-4hhu\x1b[30m%4hhu",
-                i, i, i
-            );
+            sgr(WHITE, BIT8(i));
+            frame_text("%-4hhu", i);
+            sgr(BLACK, BIT8(i));
+            frame_text("%4hhu", i);
             if (((i+1-0x10) % 6) == 0) {
-                printf("\x1b[49m\n");
+                newline();
             }
         }
         for (; i != 0; i += 1) {
-            printf(
-                "\x1b[48;5;%hhu;37m%-4hhu\x1b[30m%4hhu",
-                i, i, i
-            );
+            sgr(WHITE, BIT8(i));
+            frame_text("%-4hhu", i);
+            sgr(BLACK, BIT8(i));
+            frame_text("%4hhu", i);
             if (((i+1) & 0x7) == 0) {
-                printf("\x1b[49m\n");
+                if (i == 0xFF) {
+                    // Note: the table ends with both colors reset
+                    sgr(DEFAULT, DEFAULT);
+                }
+                newline();
+            }
+        }
+    }
+    {
+        // 24-bit Colors
+        frame_text("\n ======  ======  ======  24-bit  Colors  ======  ======  ======\n");
+        for (byte c = 0; c < 4; c += 1) {
+            // Note: red, green, blue and gray gradients
+            for (unsigned int x = 0; x < GRADIENT_LEN; x += 1) {
+                const byte v = (byte) (x * 0xFF / (GRADIENT_LEN - 1));
+                sgr_bg(RGB(
+                    (c == 0 || c == 3) ? v : 0,
+                    (c == 1 || c == 3) ? v : 0,
+                    (c == 2 || c == 3) ? v : 0
+                ));
+                frame_text(" ");
+            }
+            newline();
+        }
+        // Note: palette, hues (columns) by saturation (going up) then value (going down)
+        for (byte row = 0; row < 8; row += 1) {
+            const byte sat = (byte) (row < 4 ? 0x40 * (row + 1) - 1 : 0xFF);
+            const byte val = (byte) (row < 4 ? 0xFF : 0xFF - 0x30 * (row - 3));
+            for (unsigned int x = 0; x < GRADIENT_LEN; x += 1) {
+                sgr_bg(hsv(x * 6 * 0x100 / GRADIENT_LEN, sat, val));
+                frame_text(" ");
             }
+            newline();
         }
     }
-    printf("\x1b[0m\n");
+    sgr(DEFAULT, DEFAULT);
+    frame_text("\n");
+    frame_flush();
 }
 
 int main(void) {
+    // Note: the frame goes straight to a single `write`, with no stdio buffer in between
+    setvbuf(stdout, NULL, _IONBF, 0);
     tcolors();
     return 0;
 }